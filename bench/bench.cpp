@@ -0,0 +1,259 @@
+// reproducible benchmarks of the physics and render hot paths, results are written as json
+// usage: bench [--out FILE] [--threads N] [--full]
+//   --full also runs the O(N^2) solvers at 100k bodies (minutes per tick)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/body.hpp"
+#include "../src/bodystore.hpp"
+#include "../src/definitions.hpp"
+#include "../src/geometry.hpp"
+#include "../src/gravity.hpp"
+#include "../src/headless.hpp"
+#include "../src/snapshot.hpp"
+#include "../src/threadpool.hpp"
+#include "../src/universe.hpp"
+#include "../src/values.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+// every case repeats until both limits are reached (or maxIterations)
+constexpr double minSeconds = 0.25;
+constexpr int minIterations = 3;
+constexpr int maxIterations = 1000;
+// same bodies on every run and machine with the same standard library
+constexpr unsigned int seed = 12345;
+// O(N^2) solvers stop here unless --full is given
+constexpr size_t directLimit = 10000;
+
+struct Result {
+    std::string name;
+    size_t bodies = 0;
+    int iterations = 0;
+    // ns per iteration
+    double mean = 0.0, median = 0.0, min = 0.0;
+};
+
+// silences the universe's per body messages while a scenario is built
+struct QuietOutput {
+    std::ostringstream sink;
+    std::streambuf* saved;
+    QuietOutput() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~QuietOutput() { std::cout.rdbuf(saved); }
+};
+
+// a sun with count - 1 bodies on circular orbits in a thick disk, in the scaled units of the simulator
+void SpawnDisk(Universe& universe, size_t count) {
+    QuietOutput quiet;
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    double massScaling = SCALE * SCALE * SCALE;
+    universe.SetcScaling(SCALE);
+
+    Body body;
+    body.name = "sol";
+    body.mass = sunMass * massScaling;
+    body.radius = sunRadius * SCALE;
+    body.luminosity = 1.0f;
+    universe.AddBody(body.name, body);
+
+    body.luminosity = 0.2f;
+    for (size_t i = 1; i < count; i++) {
+        double distance = (0.4 + 30.0 * unit(random)) * earthDistance * SCALE;
+        double angle = 2.0 * pi * unit(random);
+        double speed = sqrt(G * sunMass * massScaling / distance);
+        body.name = "b" + std::to_string(i);
+        body.x = distance * cos(angle);
+        body.y = distance * sin(angle);
+        body.z = (unit(random) - 0.5) * 0.02 * distance;
+        body.xVel = -speed * sin(angle);
+        body.yVel = speed * cos(angle);
+        body.zVel = 0.0;
+        body.mass = earthMass * massScaling * unit(random);
+        body.radius = earthRadius * SCALE;
+        universe.AddBody(body.name, body);
+    }
+}
+
+// setup, if given, runs untimed before every run
+Result Measure(const std::string& name, size_t bodies, const std::function<void()>& run,
+    const std::function<void()>& setup = nullptr) {
+    // warm up caches, trees and thread pools
+    if (setup) {
+        setup();
+    }
+    run();
+    std::vector<double> samples;
+    Clock::time_point start = Clock::now();
+    while ((int)samples.size() < maxIterations) {
+        if (setup) {
+            setup();
+        }
+        Clock::time_point before = Clock::now();
+        run();
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - before).count());
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if ((int)samples.size() >= minIterations && elapsed >= minSeconds) {
+            break;
+        }
+    }
+    Result result;
+    result.name = name;
+    result.bodies = bodies;
+    result.iterations = samples.size();
+    double sum = 0.0;
+    for (double sample: samples) {
+        sum += sample;
+    }
+    std::sort(samples.begin(), samples.end());
+    result.mean = sum / samples.size();
+    result.median = samples[samples.size() / 2];
+    result.min = samples.front();
+    std::cout << name << ": median " << result.median / 1e6 << " ms over " << result.iterations << " runs\n";
+    return result;
+}
+
+void BenchTicks(std::vector<Result>& results, int threads, bool full) {
+    const size_t counts[] = { 10, 100, 1000, 10000, 100000 };
+    const char* solvers[] = { "direct", "symmetric", "barneshut", "fmm" };
+    for (const char* solver: solvers) {
+        bool exact = std::string(solver) == "direct" || std::string(solver) == "symmetric";
+        for (size_t count: counts) {
+            if (exact && count > directLimit && !full) {
+                continue;
+            }
+            Universe universe;
+            universe.SetTickSpeed(100);
+            universe.SetTimeScaling(86400);
+            universe.SetThreadCount(threads);
+            universe.SetSolver(solver);
+            SpawnDisk(universe, count);
+            results.push_back(Measure(std::string("tick/") + solver + "/" + std::to_string(count), count,
+                [&]() { universe.CalculateTick(); }));
+        }
+    }
+}
+
+void BenchSpheres(std::vector<Result>& results) {
+    const size_t counts[] = { 10, 100, 1000, 100000 };
+    for (size_t count: counts) {
+        Universe universe;
+        SpawnDisk(universe, count);
+        Snapshot snapshot;
+        snapshot.Fill(universe.GetBodies(), 0, 0.0);
+        // one frame of instance data, seen from the default window, kept between frames like in DrawFrame
+        LodView view;
+        view.pixelScale = (900 / 2.0) / tan(75.0 / 2.0 * pi / 180.0);
+        // looking along the disk from its center, about half of it is culled
+        const double front[3] = { 1.0, 0.0, 0.0 };
+        const double up[3] = { 0.0, 0.0, 1.0 };
+        SetViewFrustum(view, front, up, 75.0, 1600.0 / 900.0);
+        SphereInstances instances;
+        results.push_back(Measure("spheres/" + std::to_string(count), count, [&]() {
+            FillSphereInstances(snapshot, view, instances);
+        }));
+    }
+}
+
+void BenchPoints(std::vector<Result>& results) {
+    const size_t counts[] = { 1000, 100000, 1000000 };
+    for (size_t count: counts) {
+        Universe universe;
+        SpawnDisk(universe, count);
+        Snapshot snapshot;
+        snapshot.Fill(universe.GetBodies(), 0, 0.0);
+        // one frame of the point cloud render mode, written to memory instead of a mapped buffer
+        std::vector<CloudPoint> points(count);
+        CloudScale scale;
+        results.push_back(Measure("points/" + std::to_string(count), count, [&]() {
+            FillPointCloud(snapshot, scale, points.data());
+        }));
+    }
+}
+
+void BenchHeadless(std::vector<Result>& results, int threads) {
+    const size_t count = 1000;
+    CommandLineOptions options;
+    options.headless = true;
+    options.ticks = 200;
+    // a fresh universe per run, built outside the timing so only the tick loop is measured
+    std::unique_ptr<Universe> universe;
+    results.push_back(Measure("headless/" + std::to_string(count), count, [&]() {
+        QuietOutput quiet;
+        RunHeadless(*universe, options);
+    }, [&]() {
+        universe.reset();
+        universe.reset(new Universe());
+        universe->SetTickSpeed(100);
+        universe->SetTimeScaling(86400);
+        universe->SetThreadCount(threads);
+        SpawnDisk(*universe, count);
+    }));
+}
+
+std::string ToJson(const std::vector<Result>& results, int threads) {
+    std::ostringstream out;
+    out.precision(12);
+    out << "{\n"
+        << "  \"threads\": " << threads << ",\n"
+        << "  \"kernel\": \"" << GetGravityKernel() << "\",\n"
+        << "  \"seed\": " << seed << ",\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"bodies\": " << r.bodies << ", \"iterations\": " << r.iterations
+            << ", \"mean_ns\": " << r.mean << ", \"median_ns\": " << r.median << ", \"min_ns\": " << r.min << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return out.str();
+}
+
+int main(int argc, char* argv[]) {
+    std::string outPath = "bin/bench.json";
+    int threads = ThreadPool::HardwareThreads();
+    bool full = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--full") {
+            full = true;
+        }
+        else if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, atoi(argv[++i]));
+        }
+        else {
+            std::cout << "usage: bench [--out FILE] [--threads N] [--full]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Result> results;
+    BenchTicks(results, threads, full);
+    BenchSpheres(results);
+    BenchPoints(results);
+    BenchHeadless(results, threads);
+
+    std::ofstream file(outPath);
+    if (!file) {
+        std::cout << "cannot write " << outPath << "\n";
+        return EXIT_FAILURE;
+    }
+    file << ToJson(results, threads);
+    std::cout << "wrote " << outPath << "\n";
+    return EXIT_SUCCESS;
+}
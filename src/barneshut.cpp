@@ -0,0 +1,118 @@
+#include "barneshut.hpp"
+
+#include <cmath>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "definitions.hpp"
+#include "fmm.hpp"
+#include "gravity.hpp"
+#include "octree.hpp"
+#include "threadpool.hpp"
+
+BarnesHutSolver::BarnesHutSolver() {
+    _theta = 0.5;
+    _leafSize = 16;
+}
+
+const char* BarnesHutSolver::GetName() const {
+    return "barneshut";
+}
+
+void BarnesHutSolver::Accelerate(InteractionList& list, double px, double py, double pz, const GravityParams& params,
+    double& xAcc, double& yAcc, double& zAcc) const {
+    const double theta2 = _theta * _theta;
+    const std::vector<OctreeNode>& nodes = _tree.nodes;
+    list.x.clear();
+    list.y.clear();
+    list.z.clear();
+    list.mass.clear();
+    list.stack.clear();
+    list.stack.push_back(0);
+    while (list.stack.size() > 0) {
+        const OctreeNode& node = nodes[list.stack.back()];
+        list.stack.pop_back();
+        if (node.childCount == 0) {
+            // leaf bodies interact directly, the target itself is masked out by the kernel
+            for (uint32_t b = node.bodyBegin; b < node.bodyEnd; b++) {
+                list.x.push_back(_tree.x[b]);
+                list.y.push_back(_tree.y[b]);
+                list.z.push_back(_tree.z[b]);
+                list.mass.push_back(_tree.mass[b]);
+            }
+            continue;
+        }
+        double dx = node.comX - px;
+        double dy = node.comY - py;
+        double dz = node.comZ - pz;
+        double distanceSquared = (dx * dx) + (dy * dy) + (dz * dz);
+        double size = 2 * node.halfSize;
+        bool inside = fabs(px - node.x) <= node.halfSize && fabs(py - node.y) <= node.halfSize && fabs(pz - node.z) <= node.halfSize;
+        if (!inside && size * size < theta2 * distanceSquared) {
+            // far enough away, acts as one body at its center of mass
+            list.x.push_back(node.comX);
+            list.y.push_back(node.comY);
+            list.z.push_back(node.comZ);
+            list.mass.push_back(node.mass);
+            continue;
+        }
+        for (uint32_t c = node.childBegin; c < node.childBegin + node.childCount; c++) {
+            list.stack.push_back(c);
+        }
+    }
+
+    GravitySources sources = { list.x.data(), list.y.data(), list.z.data(), list.mass.data(), list.x.size() };
+    AccumulateAcceleration(sources, 0, sources.count, px, py, pz, params, xAcc, yAcc, zAcc);
+}
+
+int BarnesHutSolver::ComputeAccelerations(BodyStore& bodies, const GravityParams& params, ThreadPool& pool) {
+    size_t count = bodies.Size();
+    _tree.Build(bodies, _leafSize);
+    _lists.resize(pool.GetThreadCount());
+
+    // targets are walked in tree order, neighbouring targets open the same nodes
+    pool.ParallelFor(count, [&](int thread, size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            size_t i = _tree.order[k];
+            bodies.xAcc[i] = 0.0;
+            bodies.yAcc[i] = 0.0;
+            bodies.zAcc[i] = 0.0;
+            Accelerate(_lists[thread], _tree.x[k], _tree.y[k], _tree.z[k], params, bodies.xAcc[i], bodies.yAcc[i], bodies.zAcc[i]);
+        }
+    }, minTargetsPerThread);
+    return SUCCESS;
+}
+
+int BarnesHutSolver::ComputeActiveAccelerations(BodyStore& bodies, const std::vector<uint32_t>& active,
+    const GravityParams& params, ThreadPool& pool) {
+    // the tree still holds every body as a source
+    _tree.Build(bodies, _leafSize);
+    _lists.resize(pool.GetThreadCount());
+
+    pool.ParallelFor(active.size(), [&](int thread, size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            size_t i = active[k];
+            bodies.xAcc[i] = 0.0;
+            bodies.yAcc[i] = 0.0;
+            bodies.zAcc[i] = 0.0;
+            Accelerate(_lists[thread], bodies.x[i], bodies.y[i], bodies.z[i], params, bodies.xAcc[i], bodies.yAcc[i], bodies.zAcc[i]);
+        }
+    }, minTargetsPerThread);
+    return SUCCESS;
+}
+
+double BarnesHutSolver::ComputePotential(const BodyStore& bodies, const GravityParams& params, ThreadPool& pool) {
+    return _potential.ComputePotential(bodies, params, pool);
+}
+
+double BarnesHutSolver::GetOpeningAngle() const {
+    return _theta;
+}
+
+int BarnesHutSolver::SetOpeningAngle(double theta) {
+    if (theta < 0.0) {
+        return FAIL;
+    }
+    _theta = theta;
+    return SUCCESS;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef _BARNESHUT_HPP
+#define _BARNESHUT_HPP
+
+#include <vector>
+
+#include "bodystore.hpp"
+#include "fmm.hpp"
+#include "gravity.hpp"
+#include "octree.hpp"
+#include "solver.hpp"
+#include "threadpool.hpp"
+
+// O(N log N) octree approximation
+// a node is treated as one body at its center of mass when size / distance < theta
+class BarnesHutSolver : public Solver {
+    // per thread list of accepted nodes, evaluated in one kernel call
+    struct InteractionList {
+        std::vector<double> x, y, z, mass;
+        std::vector<uint32_t> stack;
+    };
+
+    Octree _tree;
+    std::vector<InteractionList> _lists;
+    // monopoles alone leave the potential off by about theta^2, far too coarse for an energy drift
+    FmmSolver _potential;
+
+    double _theta;
+    size_t _leafSize;
+
+    // adds the acceleration at (x, y, z) from the walk of the current tree
+    void Accelerate(InteractionList& list, double x, double y, double z, const GravityParams& params,
+        double& xAcc, double& yAcc, double& zAcc) const;
+public:
+    BarnesHutSolver();
+
+    const char* GetName() const override;
+    int ComputeAccelerations(BodyStore& bodies, const GravityParams& params, ThreadPool& pool) override;
+    int ComputeActiveAccelerations(BodyStore& bodies, const std::vector<uint32_t>& active,
+        const GravityParams& params, ThreadPool& pool) override;
+    // from the expansions of a default fmm, as cheap as a tick and accurate to about 1e-6
+    double ComputePotential(const BodyStore& bodies, const GravityParams& params, ThreadPool& pool) override;
+
+    // opening angle, 0 is exact
+    double GetOpeningAngle() const;
+    int SetOpeningAngle(double theta);
+};
+
+#endif
@@ -0,0 +1,280 @@
+#include "bodystore.hpp"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "body.hpp"
+#include "definitions.hpp"
+
+template <typename T>
+inline void SwapRemove(std::vector<T>& values, size_t index) {
+    if (index + 1 != values.size()) {
+        values[index] = std::move(values.back());
+    }
+    values.pop_back();
+}
+
+
+// every structural change of any store gets a new version
+static std::atomic<uint64_t> _lastVersion(0);
+
+void BodyStore::Touch() {
+    _version = ++_lastVersion;
+}
+
+
+//
+
+size_t BodyStore::Size() const {
+    return x.size();
+}
+
+bool BodyStore::Empty() const {
+    return x.empty();
+}
+
+BodyStore::Handle BodyStore::Add(const Body& body) {
+    if (body.name == "" || _nameTable.find(body.name) != _nameTable.end()) {
+        return invalidHandle;
+    }
+    uint32_t slot;
+    if (_freeSlots.size() > 0) {
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+    }
+    else {
+        slot = _slotIndex.size();
+        _slotIndex.push_back(0);
+        _slotGeneration.push_back(0);
+    }
+    size_t index = Size();
+    Handle handle = (Handle(_slotGeneration[slot]) << 32) | slot;
+    _slotIndex[slot] = index;
+
+    x.push_back(body.x);
+    y.push_back(body.y);
+    z.push_back(body.z);
+    xVel.push_back(body.xVel);
+    yVel.push_back(body.yVel);
+    zVel.push_back(body.zVel);
+    mass.push_back(body.mass);
+    xAcc.push_back(0.0);
+    yAcc.push_back(0.0);
+    zAcc.push_back(0.0);
+    theta.push_back(body.theta);
+    phi.push_back(body.phi);
+    psi.push_back(body.psi);
+    thetaVel.push_back(body.thetaVel);
+    phiVel.push_back(body.phiVel);
+    psiVel.push_back(body.psiVel);
+    radius.push_back(body.radius);
+    luminosity.push_back(body.luminosity);
+    red.push_back(body.red);
+    green.push_back(body.green);
+    blue.push_back(body.blue);
+    names.push_back(body.name);
+    _handles.push_back(handle);
+    _nameTable.emplace(body.name, handle);
+    Touch();
+    return handle;
+}
+
+int BodyStore::Remove(Handle handle) {
+    size_t index = IndexOf(handle);
+    if (index == npos) {
+        return FAIL;
+    }
+    uint32_t slot = handle & 0xFFFFFFFF;
+    _nameTable.erase(names[index]);
+    // the last body takes over the removed index
+    if (index + 1 != Size()) {
+        _slotIndex[_handles.back() & 0xFFFFFFFF] = index;
+    }
+    SwapRemove(x, index);
+    SwapRemove(y, index);
+    SwapRemove(z, index);
+    SwapRemove(xVel, index);
+    SwapRemove(yVel, index);
+    SwapRemove(zVel, index);
+    SwapRemove(mass, index);
+    SwapRemove(xAcc, index);
+    SwapRemove(yAcc, index);
+    SwapRemove(zAcc, index);
+    SwapRemove(theta, index);
+    SwapRemove(phi, index);
+    SwapRemove(psi, index);
+    SwapRemove(thetaVel, index);
+    SwapRemove(phiVel, index);
+    SwapRemove(psiVel, index);
+    SwapRemove(radius, index);
+    SwapRemove(luminosity, index);
+    SwapRemove(red, index);
+    SwapRemove(green, index);
+    SwapRemove(blue, index);
+    SwapRemove(names, index);
+    SwapRemove(_handles, index);
+    // invalidate old handles to this slot
+    _slotGeneration[slot]++;
+    _freeSlots.push_back(slot);
+    Touch();
+    return SUCCESS;
+}
+
+void BodyStore::Clear() {
+    for (Handle handle: _handles) {
+        uint32_t slot = handle & 0xFFFFFFFF;
+        _slotGeneration[slot]++;
+        _freeSlots.push_back(slot);
+    }
+    x.clear();
+    y.clear();
+    z.clear();
+    xVel.clear();
+    yVel.clear();
+    zVel.clear();
+    mass.clear();
+    xAcc.clear();
+    yAcc.clear();
+    zAcc.clear();
+    theta.clear();
+    phi.clear();
+    psi.clear();
+    thetaVel.clear();
+    phiVel.clear();
+    psiVel.clear();
+    radius.clear();
+    luminosity.clear();
+    red.clear();
+    green.clear();
+    blue.clear();
+    names.clear();
+    _handles.clear();
+    _nameTable.clear();
+    Touch();
+}
+
+int BodyStore::Rebuild() {
+    size_t count = x.size();
+    bool sized = y.size() == count && z.size() == count
+        && xVel.size() == count && yVel.size() == count && zVel.size() == count && mass.size() == count
+        && xAcc.size() == count && yAcc.size() == count && zAcc.size() == count
+        && theta.size() == count && phi.size() == count && psi.size() == count
+        && thetaVel.size() == count && phiVel.size() == count && psiVel.size() == count
+        && radius.size() == count && luminosity.size() == count
+        && red.size() == count && green.size() == count && blue.size() == count && names.size() == count;
+    // every slot is handed out again with a new generation
+    for (Handle handle: _handles) {
+        uint32_t slot = handle & 0xFFFFFFFF;
+        _slotGeneration[slot]++;
+        _freeSlots.push_back(slot);
+    }
+    _handles.clear();
+    _nameTable.clear();
+    size_t assigned = 0;
+    if (sized) {
+        _handles.resize(count);
+        _nameTable.reserve(count);
+        for (size_t index = 0; index < count && sized; index++) {
+            uint32_t slot;
+            if (_freeSlots.size() > 0) {
+                slot = _freeSlots.back();
+                _freeSlots.pop_back();
+            }
+            else {
+                slot = _slotIndex.size();
+                _slotIndex.push_back(0);
+                _slotGeneration.push_back(0);
+            }
+            _slotIndex[slot] = index;
+            _handles[index] = (Handle(_slotGeneration[slot]) << 32) | slot;
+            assigned++;
+            sized = names[index] != "" && _nameTable.emplace(names[index], _handles[index]).second;
+        }
+    }
+    if (!sized) {
+        // the handles given out above are freed again by Clear
+        _handles.resize(assigned);
+        Clear();
+        return FAIL;
+    }
+    Touch();
+    return SUCCESS;
+}
+
+BodyStore::Handle BodyStore::Find(const std::string& name) const {
+    auto it = _nameTable.find(name);
+    if (it == _nameTable.end()) {
+        return invalidHandle;
+    }
+    return it->second;
+}
+
+size_t BodyStore::IndexOf(Handle handle) const {
+    uint32_t slot = handle & 0xFFFFFFFF;
+    uint32_t generation = handle >> 32;
+    if (handle == invalidHandle || slot >= _slotIndex.size() || _slotGeneration[slot] != generation) {
+        return npos;
+    }
+    return _slotIndex[slot];
+}
+
+size_t BodyStore::IndexOf(const std::string& name) const {
+    return IndexOf(Find(name));
+}
+
+BodyStore::Handle BodyStore::HandleAt(size_t index) const {
+    if (index >= Size()) {
+        return invalidHandle;
+    }
+    return _handles[index];
+}
+
+uint64_t BodyStore::Version() const {
+    return _version;
+}
+
+Body BodyStore::GetBody(size_t index) const {
+    Body body;
+    body.name = names[index];
+    body.x = x[index];
+    body.y = y[index];
+    body.z = z[index];
+    body.xVel = xVel[index];
+    body.yVel = yVel[index];
+    body.zVel = zVel[index];
+    body.theta = theta[index];
+    body.phi = phi[index];
+    body.psi = psi[index];
+    body.thetaVel = thetaVel[index];
+    body.phiVel = phiVel[index];
+    body.psiVel = psiVel[index];
+    body.radius = radius[index];
+    body.mass = mass[index];
+    body.luminosity = luminosity[index];
+    body.red = red[index];
+    body.green = green[index];
+    body.blue = blue[index];
+    return body;
+}
+
+void BodyStore::SetBody(size_t index, const Body& body) {
+    x[index] = body.x;
+    y[index] = body.y;
+    z[index] = body.z;
+    xVel[index] = body.xVel;
+    yVel[index] = body.yVel;
+    zVel[index] = body.zVel;
+    theta[index] = body.theta;
+    phi[index] = body.phi;
+    psi[index] = body.psi;
+    thetaVel[index] = body.thetaVel;
+    phiVel[index] = body.phiVel;
+    psiVel[index] = body.psiVel;
+    radius[index] = body.radius;
+    mass[index] = body.mass;
+    luminosity[index] = body.luminosity;
+    red[index] = body.red;
+    green[index] = body.green;
+    blue[index] = body.blue;
+}
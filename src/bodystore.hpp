@@ -0,0 +1,85 @@
+#pragma once
+#ifndef _BODYSTORE_HPP
+#define _BODYSTORE_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "body.hpp"
+
+// structure-of-arrays storage for every body in a universe
+// index i refers to the same body across all arrays, indices are dense [0, Size())
+// indices move when bodies are removed, handles do not
+// arrays may be read and written in place, but only resized through the member functions
+struct BodyStore {
+    // stable reference to a body, survives adds / removes of other bodies
+    using Handle = uint64_t;
+    static constexpr Handle invalidHandle = ~Handle(0);
+    static constexpr size_t npos = ~size_t(0);
+
+    // hot data (read every tick)
+
+    // m
+    std::vector<double> x, y, z;
+    // m/s
+    std::vector<double> xVel, yVel, zVel;
+    // kg
+    std::vector<double> mass;
+    // m/s^2, from the last force evaluation
+    std::vector<double> xAcc, yAcc, zAcc;
+
+    // cold data
+
+    // degrees
+    std::vector<double> theta, phi, psi;
+    // degrees / s
+    std::vector<double> thetaVel, phiVel, psiVel;
+    // m
+    std::vector<double> radius;
+    std::vector<float> luminosity;
+    std::vector<float> red, green, blue;
+    std::vector<std::string> names;
+
+    size_t Size() const;
+    bool Empty() const;
+
+    // returns invalidHandle if the name is empty or already taken
+    Handle Add(const Body& body);
+    // swaps the last body into the removed slot
+    int Remove(Handle handle);
+    void Clear();
+    // for bulk loading: after every array was replaced with one of the same length,
+    // gives each body a new handle (old ones become invalid) and rebuilds the name lookup
+    // fails if the lengths differ or a name is empty or repeated, the store is then left empty
+    int Rebuild();
+
+    // lookups, return invalidHandle / npos if not found
+    Handle Find(const std::string& name) const;
+    size_t IndexOf(Handle handle) const;
+    size_t IndexOf(const std::string& name) const;
+    Handle HandleAt(size_t index) const;
+
+    // changes whenever bodies are added or removed, unique across all stores
+    // stores (and copies of them) with equal versions have the same names in the same order
+    uint64_t Version() const;
+
+    // gathers / scatters the arrays at index to / from a Body
+    Body GetBody(size_t index) const;
+    // name is not changed
+    void SetBody(size_t index, const Body& body);
+
+private:
+    // handle = (generation << 32) | slot
+    std::vector<uint32_t> _slotIndex;
+    std::vector<uint32_t> _slotGeneration;
+    std::vector<uint32_t> _freeSlots;
+    std::vector<Handle> _handles; // per index
+    std::unordered_map<std::string, Handle> _nameTable;
+    uint64_t _version = 0;
+
+    void Touch();
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "checkpoint.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "definitions.hpp"
+#include "mappedfile.hpp"
+
+// every section starts on a cache line, so mapped arrays can be used as they are
+constexpr uint64_t sectionAlignment = 64;
+constexpr char checkpointMagic[8] = { 'G', 'R', 'A', 'V', 'C', 'K', 'P', 'T' };
+
+enum Section {
+    // doubles
+    sectionX, sectionY, sectionZ,
+    sectionXVel, sectionYVel, sectionZVel,
+    sectionMass,
+    sectionTheta, sectionPhi, sectionPsi,
+    sectionThetaVel, sectionPhiVel, sectionPsiVel,
+    sectionRadius,
+    // floats
+    sectionLuminosity, sectionRed, sectionGreen, sectionBlue,
+    // uint64 offsets, then characters
+    sectionNameOffsets, sectionNameData,
+    sectionCount
+};
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t headerSize;
+    uint64_t fileSize;
+    uint64_t bodyCount;
+    uint64_t tick;
+    double simulatedTime;
+    double tickSpeed;
+    double timeScaling;
+    double gravityScaling;
+    double cScaling;
+    uint64_t sectionOffset[sectionCount];
+    uint64_t sectionSize[sectionCount];
+};
+static_assert(std::is_trivially_copyable<CheckpointHeader>::value, "header is written as raw bytes");
+
+inline uint64_t AlignUp(uint64_t offset) {
+    return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+}
+
+// the arrays in section order, so save and load cannot disagree
+template <class Store>
+inline auto DoubleSection(Store& bodies, int section) -> decltype(&bodies.x) {
+    decltype(&bodies.x) arrays[] = {
+        &bodies.x, &bodies.y, &bodies.z,
+        &bodies.xVel, &bodies.yVel, &bodies.zVel,
+        &bodies.mass,
+        &bodies.theta, &bodies.phi, &bodies.psi,
+        &bodies.thetaVel, &bodies.phiVel, &bodies.psiVel,
+        &bodies.radius
+    };
+    return arrays[section - sectionX];
+}
+
+template <class Store>
+inline auto FloatSection(Store& bodies, int section) -> decltype(&bodies.red) {
+    decltype(&bodies.red) arrays[] = { &bodies.luminosity, &bodies.red, &bodies.green, &bodies.blue };
+    return arrays[section - sectionLuminosity];
+}
+
+
+int SaveCheckpoint(const std::string& path, const BodyStore& bodies, const CheckpointScalars& scalars) {
+    uint64_t count = bodies.Size();
+    std::vector<uint64_t> nameOffsets(count + 1, 0);
+    for (uint64_t i = 0; i < count; i++) {
+        nameOffsets[i + 1] = nameOffsets[i] + bodies.names[i].size();
+    }
+
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, checkpointMagic, sizeof(header.magic));
+    header.version = checkpointVersion;
+    header.byteOrder = byteOrderMark;
+    header.headerSize = sizeof(header);
+    header.bodyCount = count;
+    header.tick = scalars.tick;
+    header.simulatedTime = scalars.simulatedTime;
+    header.tickSpeed = scalars.tickSpeed;
+    header.timeScaling = scalars.timeScaling;
+    header.gravityScaling = scalars.gravityScaling;
+    header.cScaling = scalars.cScaling;
+    uint64_t offset = AlignUp(sizeof(header));
+    for (int section = 0; section < sectionCount; section++) {
+        uint64_t size;
+        if (section <= sectionRadius) {
+            size = count * sizeof(double);
+        }
+        else if (section <= sectionBlue) {
+            size = count * sizeof(float);
+        }
+        else if (section == sectionNameOffsets) {
+            size = (count + 1) * sizeof(uint64_t);
+        }
+        else {
+            size = nameOffsets[count];
+        }
+        header.sectionOffset[section] = offset;
+        header.sectionSize[section] = size;
+        offset = AlignUp(offset + size);
+    }
+    header.fileSize = offset;
+
+    // written next to path and renamed over it once complete, so a crash or full disk keeps the old checkpoint
+    std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "cannot write " << temporaryPath << "\n";
+        return FAIL;
+    }
+    const char padding[sectionAlignment] = {};
+    uint64_t written = 0;
+    auto write = [&](const void* data, uint64_t size) {
+        file.write((const char*)data, size);
+        written += size;
+        file.write(padding, AlignUp(written) - written);
+        written = AlignUp(written);
+    };
+    write(&header, sizeof(header));
+    for (int section = 0; section < sectionCount; section++) {
+        if (section <= sectionRadius) {
+            write(DoubleSection(bodies, section)->data(), header.sectionSize[section]);
+        }
+        else if (section <= sectionBlue) {
+            write(FloatSection(bodies, section)->data(), header.sectionSize[section]);
+        }
+        else if (section == sectionNameOffsets) {
+            write(nameOffsets.data(), header.sectionSize[section]);
+        }
+        else {
+            for (const std::string& name: bodies.names) {
+                file.write(name.data(), name.size());
+            }
+            written += header.sectionSize[section];
+            file.write(padding, AlignUp(written) - written);
+            written = AlignUp(written);
+        }
+    }
+    file.flush();
+    file.close();
+    if (!file) {
+        std::cout << "failed writing " << temporaryPath << "\n";
+        std::remove(temporaryPath.c_str());
+        return FAIL;
+    }
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        // windows does not rename over an existing file
+        std::remove(path.c_str());
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            std::cout << "cannot replace " << path << ", the checkpoint is in " << temporaryPath << "\n";
+            return FAIL;
+        }
+    }
+    return SUCCESS;
+}
+
+int LoadCheckpoint(const std::string& path, BodyStore& bodies, CheckpointScalars& scalars) {
+    MappedFile file;
+    if (file.Open(path) <= FAIL) {
+        std::cout << "cannot open " << path << "\n";
+        return FAIL;
+    }
+    file.AdviseSequential();
+    CheckpointHeader header;
+    if (file.Size() < sizeof(header)) {
+        std::cout << path << " is not a checkpoint\n";
+        return FAIL;
+    }
+    memcpy(&header, file.Data(), sizeof(header));
+    if (memcmp(header.magic, checkpointMagic, sizeof(header.magic)) != 0) {
+        std::cout << path << " is not a checkpoint\n";
+        return FAIL;
+    }
+    if (header.byteOrder != byteOrderMark || header.version != checkpointVersion || header.headerSize != sizeof(header)) {
+        std::cout << path << " has checkpoint version " << header.version << ", expected " << checkpointVersion << " (same byte order)\n";
+        return FAIL;
+    }
+    uint64_t count = header.bodyCount;
+    bool valid = header.fileSize == file.Size() && count < file.Size()
+        && header.tickSpeed > 0.0 && header.timeScaling > 0.0 && header.cScaling > 0.0;
+    for (int section = 0; valid && section < sectionCount; section++) {
+        uint64_t expected;
+        if (section <= sectionRadius) {
+            expected = count * sizeof(double);
+        }
+        else if (section <= sectionBlue) {
+            expected = count * sizeof(float);
+        }
+        else if (section == sectionNameOffsets) {
+            expected = (count + 1) * sizeof(uint64_t);
+        }
+        else {
+            expected = header.sectionSize[section];
+        }
+        uint64_t begin = header.sectionOffset[section];
+        valid = header.sectionSize[section] == expected && begin % sectionAlignment == 0
+            && begin <= file.Size() && expected <= file.Size() - begin;
+    }
+    const uint64_t* nameOffsets = nullptr;
+    if (valid) {
+        nameOffsets = (const uint64_t*)(file.Data() + header.sectionOffset[sectionNameOffsets]);
+        valid = nameOffsets[0] == 0 && nameOffsets[count] == header.sectionSize[sectionNameData];
+        for (uint64_t i = 0; valid && i < count; i++) {
+            valid = nameOffsets[i] <= nameOffsets[i + 1];
+        }
+    }
+    if (!valid) {
+        std::cout << path << " is damaged or truncated\n";
+        return FAIL;
+    }
+
+    // every array is copied straight out of the mapping, nothing is parsed per field
+    BodyStore loaded;
+    for (int section = 0; section <= sectionRadius; section++) {
+        const double* values = (const double*)(file.Data() + header.sectionOffset[section]);
+        DoubleSection(loaded, section)->assign(values, values + count);
+    }
+    for (int section = sectionLuminosity; section <= sectionBlue; section++) {
+        const float* values = (const float*)(file.Data() + header.sectionOffset[section]);
+        FloatSection(loaded, section)->assign(values, values + count);
+    }
+    loaded.xAcc.assign(count, 0.0);
+    loaded.yAcc.assign(count, 0.0);
+    loaded.zAcc.assign(count, 0.0);
+    const char* nameData = (const char*)(file.Data() + header.sectionOffset[sectionNameData]);
+    loaded.names.resize(count);
+    for (uint64_t i = 0; i < count; i++) {
+        loaded.names[i].assign(nameData + nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i]);
+    }
+    if (loaded.Rebuild() <= FAIL) {
+        std::cout << path << " has empty or repeated body names\n";
+        return FAIL;
+    }
+
+    bodies = std::move(loaded);
+    scalars.tick = header.tick;
+    scalars.simulatedTime = header.simulatedTime;
+    scalars.tickSpeed = header.tickSpeed;
+    scalars.timeScaling = header.timeScaling;
+    scalars.gravityScaling = header.gravityScaling;
+    scalars.cScaling = header.cScaling;
+    return SUCCESS;
+}
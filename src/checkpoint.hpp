@@ -0,0 +1,33 @@
+#pragma once
+#ifndef _CHECKPOINT_HPP
+#define _CHECKPOINT_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "bodystore.hpp"
+
+// universe settings stored next to the bodies
+struct CheckpointScalars {
+    unsigned long long tick = 0;
+    // s
+    double simulatedTime = 0.0;
+    double tickSpeed = 60.0;
+    double timeScaling = 1.0;
+    double gravityScaling = 1.0;
+    double cScaling = 1.0;
+};
+
+// file layout (version 1), native byte order (files from a machine with the other one are rejected by byteOrderMark):
+//   header, then one section per body array in BodyStore order, each starting on a 64 byte boundary
+//   names are a table of count + 1 uint64 offsets into a blob of characters
+// loading copies every section with a single memcpy from a read-only mapping of the file
+constexpr uint32_t checkpointVersion = 1;
+
+// writes bodies and scalars to path + ".tmp", then renames it over path
+int SaveCheckpoint(const std::string& path, const BodyStore& bodies, const CheckpointScalars& scalars);
+// replaces bodies and scalars with the contents of path
+// fails without touching them if the file is missing, from another version or damaged
+int LoadCheckpoint(const std::string& path, BodyStore& bodies, CheckpointScalars& scalars);
+
+#endif
@@ -0,0 +1,251 @@
+#include "collision.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "bodystore.hpp"
+#include "definitions.hpp"
+
+// the insertion sort gives up after this many moves per interval and sorts from scratch
+constexpr size_t maxMovesPerInterval = 8;
+
+CollisionSystem::CollisionSystem() {
+    _response = Response::off;
+    _axis = 0;
+    _lastContacts = 0;
+}
+
+// private
+
+void CollisionSystem::SortIntervals(const BodyStore& bodies) {
+    size_t count = bodies.Size();
+    const std::vector<double>* axes[3] = { &bodies.x, &bodies.y, &bodies.z };
+
+    // sweeping along the widest axis keeps the fewest false overlaps (the solar system is flat in z)
+    int axis = 0;
+    double widest = -1.0;
+    for (int a = 0; a < 3; a++) {
+        if (count == 0) {
+            break;
+        }
+        auto range = std::minmax_element(axes[a]->begin(), axes[a]->end());
+        if (*range.second - *range.first > widest) {
+            widest = *range.second - *range.first;
+            axis = a;
+        }
+    }
+    const std::vector<double>& position = *axes[axis];
+
+    bool coherent = _intervals.size() == count && axis == _axis;
+    _axis = axis;
+    if (!coherent) {
+        _intervals.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            _intervals[i].index = i;
+        }
+    }
+    for (Interval& interval: _intervals) {
+        interval.begin = position[interval.index] - bodies.radius[interval.index];
+        interval.end = position[interval.index] + bodies.radius[interval.index];
+    }
+
+    auto earlier = [](const Interval& a, const Interval& b) { return a.begin < b.begin; };
+    if (coherent) {
+        // last tick's order is nearly sorted
+        size_t moves = 0;
+        size_t moveLimit = maxMovesPerInterval * count;
+        for (size_t k = 1; k < count && moves <= moveLimit; k++) {
+            Interval interval = _intervals[k];
+            size_t m = k;
+            for (; m > 0 && interval.begin < _intervals[m - 1].begin; m--) {
+                _intervals[m] = _intervals[m - 1];
+            }
+            _intervals[m] = interval;
+            moves += k - m;
+        }
+        if (moves <= moveLimit) {
+            return;
+        }
+    }
+    std::sort(_intervals.begin(), _intervals.end(), earlier);
+}
+
+void CollisionSystem::Bounce(BodyStore& b, size_t i, size_t j) {
+    double dx = b.x[j] - b.x[i];
+    double dy = b.y[j] - b.y[i];
+    double dz = b.z[j] - b.z[i];
+    double distance = sqrt((dx * dx) + (dy * dy) + (dz * dz));
+    double nx = 1.0, ny = 0.0, nz = 0.0;
+    if (distance > 0.0) {
+        nx = dx / distance;
+        ny = dy / distance;
+        nz = dz / distance;
+    }
+    // share of the correction each body takes, the lighter one moves more
+    double totalMass = b.mass[i] + b.mass[j];
+    double shareI = totalMass > 0.0 ? b.mass[j] / totalMass : 0.5;
+    double shareJ = 1.0 - shareI;
+
+    double approach = ((b.xVel[j] - b.xVel[i]) * nx) + ((b.yVel[j] - b.yVel[i]) * ny) + ((b.zVel[j] - b.zVel[i]) * nz);
+    if (approach < 0.0) {
+        // elastic: the normal components of the relative velocity are reversed
+        b.xVel[i] += 2.0 * shareI * approach * nx;
+        b.yVel[i] += 2.0 * shareI * approach * ny;
+        b.zVel[i] += 2.0 * shareI * approach * nz;
+        b.xVel[j] -= 2.0 * shareJ * approach * nx;
+        b.yVel[j] -= 2.0 * shareJ * approach * ny;
+        b.zVel[j] -= 2.0 * shareJ * approach * nz;
+    }
+
+    // separate to touching, so the pair is not found again next tick
+    double overlap = b.radius[i] + b.radius[j] - distance;
+    b.x[i] -= overlap * shareI * nx;
+    b.y[i] -= overlap * shareI * ny;
+    b.z[i] -= overlap * shareI * nz;
+    b.x[j] += overlap * shareJ * nx;
+    b.y[j] += overlap * shareJ * ny;
+    b.z[j] += overlap * shareJ * nz;
+}
+
+bool CollisionSystem::Merge(BodyStore& b, size_t i, size_t j) {
+    if (_absorbed[i] || _absorbed[j]) {
+        return false;
+    }
+    // the heavier body survives and keeps its name and spin
+    if (b.mass[j] > b.mass[i]) {
+        std::swap(i, j);
+    }
+    double totalMass = b.mass[i] + b.mass[j];
+    double wi = totalMass > 0.0 ? b.mass[i] / totalMass : 0.5;
+    double wj = 1.0 - wi;
+
+    // center of mass and momentum are conserved
+    b.x[i] = (wi * b.x[i]) + (wj * b.x[j]);
+    b.y[i] = (wi * b.y[i]) + (wj * b.y[j]);
+    b.z[i] = (wi * b.z[i]) + (wj * b.z[j]);
+    b.xVel[i] = (wi * b.xVel[i]) + (wj * b.xVel[j]);
+    b.yVel[i] = (wi * b.yVel[i]) + (wj * b.yVel[j]);
+    b.zVel[i] = (wi * b.zVel[i]) + (wj * b.zVel[j]);
+    b.mass[i] = totalMass;
+    // volumes add
+    b.radius[i] = cbrt((b.radius[i] * b.radius[i] * b.radius[i]) + (b.radius[j] * b.radius[j] * b.radius[j]));
+    b.luminosity[i] = std::max(b.luminosity[i], b.luminosity[j]);
+    b.red[i] = (float)((wi * b.red[i]) + (wj * b.red[j]));
+    b.green[i] = (float)((wi * b.green[i]) + (wj * b.green[j]));
+    b.blue[i] = (float)((wi * b.blue[i]) + (wj * b.blue[j]));
+
+    _absorbed[j] = 1;
+    _removals.push_back(b.HandleAt(j));
+    std::cout << "collision: " << b.names[j] << " merged into " << b.names[i] << "\n";
+    return true;
+}
+
+
+// public
+
+int CollisionSystem::Resolve(BodyStore& bodies, bool& modified) {
+    modified = false;
+    _lastContacts = 0;
+    if (_response != Response::log) {
+        _touching.clear();
+    }
+    if (_response == Response::off) {
+        return SUCCESS;
+    }
+    SortIntervals(bodies);
+
+    // only intervals that start before the current one ends can touch it
+    _pairs.clear();
+    size_t count = _intervals.size();
+    for (size_t a = 0; a < count; a++) {
+        const Interval& first = _intervals[a];
+        for (size_t c = a + 1; c < count && _intervals[c].begin <= first.end; c++) {
+            uint32_t i = first.index, j = _intervals[c].index;
+            if (CheckCollision(bodies, i, j)) {
+                _pairs.emplace_back(std::min(i, j), std::max(i, j));
+            }
+        }
+    }
+    _lastContacts = _pairs.size();
+    // a log response also has to forget pairs that stopped touching
+    if (_pairs.empty() && _touching.empty()) {
+        return SUCCESS;
+    }
+
+    switch (_response) {
+    case Response::log:
+        // resting contacts would print every tick, get collisions still counts them
+        _touchingNow.clear();
+        for (const auto& pair: _pairs) {
+            BodyStore::Handle first = bodies.HandleAt(pair.first), second = bodies.HandleAt(pair.second);
+            _touchingNow.emplace_back(std::min(first, second), std::max(first, second));
+        }
+        std::sort(_touchingNow.begin(), _touchingNow.end());
+        for (const auto& pair: _touchingNow) {
+            if (!std::binary_search(_touching.begin(), _touching.end(), pair)) {
+                std::cout << "collision: " << bodies.names[bodies.IndexOf(pair.first)] << " - "
+                    << bodies.names[bodies.IndexOf(pair.second)] << "\n";
+            }
+        }
+        _touching.swap(_touchingNow);
+        break;
+    case Response::bounce:
+        for (const auto& pair: _pairs) {
+            Bounce(bodies, pair.first, pair.second);
+        }
+        modified = true;
+        break;
+    case Response::merge:
+        _absorbed.assign(bodies.Size(), 0);
+        _removals.clear();
+        for (const auto& pair: _pairs) {
+            Merge(bodies, pair.first, pair.second);
+        }
+        // handles stay valid while earlier removals move other bodies
+        for (BodyStore::Handle handle: _removals) {
+            bodies.Remove(handle);
+        }
+        modified = true;
+        break;
+    default:
+        break;
+    }
+    return SUCCESS;
+}
+
+const char* CollisionSystem::GetResponse() const {
+    switch (_response) {
+    case Response::log:
+        return "log";
+    case Response::bounce:
+        return "bounce";
+    case Response::merge:
+        return "merge";
+    default:
+        return "off";
+    }
+}
+
+int CollisionSystem::SetResponse(const std::string& name) {
+    if (name == "off") {
+        _response = Response::off;
+    }
+    else if (name == "log") {
+        _response = Response::log;
+    }
+    else if (name == "bounce") {
+        _response = Response::bounce;
+    }
+    else if (name == "merge") {
+        _response = Response::merge;
+    }
+    else {
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+size_t CollisionSystem::GetLastContacts() const {
+    return _lastContacts;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef _COLLISION_HPP
+#define _COLLISION_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "body.hpp"
+#include "bodystore.hpp"
+
+inline bool CheckCollision(const Body& obj1, const Body& obj2) {
+    double dx = obj2.x - obj1.x;
+    double dy = obj2.y - obj1.y;
+    double dz = obj2.z - obj1.z;
+    double distance = sqrt((dx * dx) + (dy * dy) + (dz * dz));
+    if ((obj1.radius + obj2.radius) >= distance) {
+        return true;
+    }
+    return false;
+}
+
+inline bool CheckCollision(const Body& obj1, const Body& obj2, double distanceSquared) {
+    double distance = sqrt(distanceSquared);
+    if ((obj1.radius + obj2.radius) >= distance) {
+        return true;
+    }
+    return false;
+}
+
+// same test on store indices, without the square root
+inline bool CheckCollision(const BodyStore& bodies, size_t i, size_t j) {
+    double dx = bodies.x[j] - bodies.x[i];
+    double dy = bodies.y[j] - bodies.y[i];
+    double dz = bodies.z[j] - bodies.z[i];
+    double reach = bodies.radius[i] + bodies.radius[j];
+    return (reach * reach) >= (dx * dx) + (dy * dy) + (dz * dz);
+}
+
+// per tick contact pass over a BodyStore
+// broad phase: sweep and prune of [p - radius, p + radius] along the axis with the largest spread
+// narrow phase: CheckCollision
+class CollisionSystem {
+public:
+    enum class Response {
+        off,    // no pass at all
+        log,    // print pairs that start touching
+        bounce, // elastic, touching bodies are pushed apart
+        merge   // the lighter body is absorbed, conserving mass and momentum
+    };
+
+private:
+    struct Interval {
+        double begin, end;
+        uint32_t index;
+    };
+
+    Response _response;
+    // kept sorted between ticks, motion is coherent so re-sorting is close to linear
+    std::vector<Interval> _intervals;
+    int _axis;
+    std::vector<std::pair<uint32_t, uint32_t>> _pairs;
+    // pairs touching in the last logged tick, sorted, by handle so they survive index changes
+    std::vector<std::pair<BodyStore::Handle, BodyStore::Handle>> _touching;
+    std::vector<std::pair<BodyStore::Handle, BodyStore::Handle>> _touchingNow;
+    std::vector<uint8_t> _absorbed;
+    std::vector<BodyStore::Handle> _removals;
+    size_t _lastContacts;
+
+    void SortIntervals(const BodyStore& bodies);
+    void Bounce(BodyStore& bodies, size_t i, size_t j);
+    // returns false if one of the two was already absorbed this tick
+    bool Merge(BodyStore& bodies, size_t i, size_t j);
+public:
+    CollisionSystem();
+
+    // finds and responds to every touching pair
+    // modified is set if positions, velocities or the bodies themselves changed
+    // merging removes bodies, so indices are not stable across this call
+    int Resolve(BodyStore& bodies, bool& modified);
+
+    const char* GetResponse() const;
+    // "off", "log", "bounce" or "merge"
+    int SetResponse(const std::string& name);
+    // touching pairs found by the last pass
+    size_t GetLastContacts() const;
+};
+
+#endif
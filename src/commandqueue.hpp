@@ -0,0 +1,57 @@
+#pragma once
+#ifndef _COMMANDQUEUE_HPP
+#define _COMMANDQUEUE_HPP
+
+#include <atomic>
+#include <utility>
+
+// unbounded lock-free queue, any number of producers and a single consumer (Vyukov)
+// Push never waits, Pop may briefly miss a value whose Push has not finished linking it
+template <class T>
+class MpscQueue {
+    struct Node {
+        std::atomic<Node*> next;
+        T value;
+    };
+    // newest node, shared by producers
+    std::atomic<Node*> _head;
+    // already consumed node in front of the oldest value, owned by the consumer
+    Node* _tail;
+public:
+    MpscQueue() {
+        _tail = new Node();
+        _tail->next.store(nullptr, std::memory_order_relaxed);
+        _head.store(_tail, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue() {
+        T value;
+        while (Pop(value)) {}
+        delete _tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void Push(T value) {
+        Node* node = new Node();
+        node->value = std::move(value);
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node* previous = _head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // consumer only
+    bool Pop(T& value) {
+        Node* next = _tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+        value = std::move(next->value);
+        delete _tail;
+        _tail = next;
+        return true;
+    }
+};
+
+#endif
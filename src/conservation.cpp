@@ -0,0 +1,130 @@
+#include "conservation.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "bodystore.hpp"
+#include "definitions.hpp"
+#include "gravity.hpp"
+#include "solver.hpp"
+#include "threadpool.hpp"
+
+// ticks between potential evaluations, keeps the potential rare next to the O(N) terms
+constexpr int defaultEnergyInterval = 100;
+
+inline double RelativeDrift(double change, double scale) {
+    return scale > 0.0 ? fabs(change) / scale : 0.0;
+}
+
+
+// public
+
+ConservationMonitor::ConservationMonitor() {
+    _energyInterval = defaultEnergyInterval;
+    _nextEnergyTick = 0;
+    Reset();
+}
+
+const ConservationStats& ConservationMonitor::GetStats() const {
+    return _stats;
+}
+
+int ConservationMonitor::GetEnergyInterval() const {
+    return _energyInterval;
+}
+
+int ConservationMonitor::SetEnergyInterval(int ticks) {
+    if (ticks < 0) {
+        return FAIL;
+    }
+    if (_energyInterval == 0 && ticks > 0) {
+        // the baseline has no energy yet
+        Reset();
+        _nextEnergyTick = 0;
+    }
+    else if (_stats.hasEnergy) {
+        _nextEnergyTick = _stats.energyTick + ticks;
+    }
+    _energyInterval = ticks;
+    if (ticks == 0) {
+        _stats.hasEnergy = false;
+    }
+    return SUCCESS;
+}
+
+void ConservationMonitor::Reset() {
+    _hasBaseline = false;
+    _hasEnergyBaseline = false;
+    // the last potential belongs to the old bodies
+    _stats.hasEnergy = false;
+    _stats.energyDrift = 0.0;
+    _stats.momentumDrift = 0.0;
+    _stats.angularMomentumDrift = 0.0;
+}
+
+void ConservationMonitor::Update(const BodyStore& bodies, unsigned long long tick, Solver& solver, const GravityParams& params, ThreadPool& pool) {
+    // one pass over the hot arrays for every O(N) term
+    double kinetic = 0.0;
+    double p[3] = { 0.0, 0.0, 0.0 };
+    double l[3] = { 0.0, 0.0, 0.0 };
+    double pScale = 0.0, lScale = 0.0;
+    size_t count = bodies.Size();
+    for (size_t i = 0; i < count; i++) {
+        double m = bodies.mass[i];
+        double px = m * bodies.xVel[i], py = m * bodies.yVel[i], pz = m * bodies.zVel[i];
+        double lx = (bodies.y[i] * pz) - (bodies.z[i] * py);
+        double ly = (bodies.z[i] * px) - (bodies.x[i] * pz);
+        double lz = (bodies.x[i] * py) - (bodies.y[i] * px);
+        double pSquared = (px * px) + (py * py) + (pz * pz);
+        kinetic += m > 0.0 ? 0.5 * pSquared / m : 0.0;
+        p[0] += px, p[1] += py, p[2] += pz;
+        l[0] += lx, l[1] += ly, l[2] += lz;
+        pScale += sqrt(pSquared);
+        lScale += sqrt((lx * lx) + (ly * ly) + (lz * lz));
+    }
+    _stats.tick = tick;
+    _stats.kinetic = kinetic;
+    for (int k = 0; k < 3; k++) {
+        _stats.momentum[k] = p[k];
+        _stats.angularMomentum[k] = l[k];
+    }
+
+    // a tick going backwards (loaded checkpoint) restarts the schedule
+    bool energyDue = _energyInterval > 0 && (tick >= _nextEnergyTick || tick < _stats.energyTick);
+    if (energyDue) {
+        _stats.potential = solver.ComputePotential(bodies, params, pool);
+        _stats.energy = kinetic + _stats.potential;
+        _stats.energyTick = tick;
+        _stats.hasEnergy = true;
+        _nextEnergyTick = tick + _energyInterval;
+        if (_hasEnergyBaseline) {
+            _stats.energyDrift = RelativeDrift(_stats.energy - _baseEnergy, fabs(_baseEnergy));
+            _stats.maxEnergyDrift = std::max(_stats.maxEnergyDrift, _stats.energyDrift);
+        }
+        else {
+            _baseEnergy = _stats.energy;
+            _hasEnergyBaseline = true;
+        }
+    }
+
+    if (!_hasBaseline) {
+        for (int k = 0; k < 3; k++) {
+            _baseMomentum[k] = p[k];
+            _baseAngularMomentum[k] = l[k];
+        }
+        _momentumScale = pScale;
+        _angularMomentumScale = lScale;
+        _hasBaseline = true;
+        return;
+    }
+
+    double dp[3], dl[3];
+    for (int k = 0; k < 3; k++) {
+        dp[k] = p[k] - _baseMomentum[k];
+        dl[k] = l[k] - _baseAngularMomentum[k];
+    }
+    _stats.momentumDrift = RelativeDrift(sqrt((dp[0] * dp[0]) + (dp[1] * dp[1]) + (dp[2] * dp[2])), _momentumScale);
+    _stats.angularMomentumDrift = RelativeDrift(sqrt((dl[0] * dl[0]) + (dl[1] * dl[1]) + (dl[2] * dl[2])), _angularMomentumScale);
+    _stats.maxMomentumDrift = std::max(_stats.maxMomentumDrift, _stats.momentumDrift);
+    _stats.maxAngularMomentumDrift = std::max(_stats.maxAngularMomentumDrift, _stats.angularMomentumDrift);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef _CONSERVATION_HPP
+#define _CONSERVATION_HPP
+
+#include "bodystore.hpp"
+#include "gravity.hpp"
+#include "solver.hpp"
+#include "threadpool.hpp"
+
+// conserved totals of a universe and how far they moved since the baseline
+// drifts are relative: energy to |E0|, momenta to the sum of the per body magnitudes
+struct ConservationStats {
+    unsigned long long tick = 0;       // of the last update
+    unsigned long long energyTick = 0; // of the last potential evaluation
+    bool hasEnergy = false;
+    // J
+    double kinetic = 0.0;
+    double potential = 0.0;
+    double energy = 0.0;
+    // kg m/s
+    double momentum[3] = { 0.0, 0.0, 0.0 };
+    // kg m^2/s, about the origin
+    double angularMomentum[3] = { 0.0, 0.0, 0.0 };
+
+    double energyDrift = 0.0;
+    double momentumDrift = 0.0;
+    double angularMomentumDrift = 0.0;
+    // largest drifts of the run, kept when the baseline is reset
+    double maxEnergyDrift = 0.0;
+    double maxMomentumDrift = 0.0;
+    double maxAngularMomentumDrift = 0.0;
+};
+
+// tracks energy, momentum and angular momentum across ticks
+// the O(N) terms are summed every tick in one pass, the potential every energyInterval ticks by the active solver
+// the potential is newtonian, so the relativity correction shows up as a small energy drift
+class ConservationMonitor {
+    ConservationStats _stats;
+    bool _hasBaseline;
+    // the energy baseline waits for the next scheduled potential evaluation after a reset
+    bool _hasEnergyBaseline;
+    unsigned long long _nextEnergyTick;
+    double _baseEnergy;
+    double _baseMomentum[3];
+    double _baseAngularMomentum[3];
+    // sums of |m v| and |r x m v| at the baseline, scale the momentum drifts
+    double _momentumScale;
+    double _angularMomentumScale;
+    int _energyInterval;
+public:
+    ConservationMonitor();
+
+    const ConservationStats& GetStats() const;
+    int GetEnergyInterval() const;
+    // 0 stops the potential evaluation (and with it the energy drift)
+    int SetEnergyInterval(int ticks);
+
+    // the next update becomes the new baseline, for changes that legitimately alter the totals
+    // the maxima stay, the energy baseline follows at the next scheduled potential evaluation
+    void Reset();
+    void Update(const BodyStore& bodies, unsigned long long tick, Solver& solver, const GravityParams& params, ThreadPool& pool);
+};
+
+#endif
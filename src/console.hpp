@@ -2,7 +2,9 @@
 #ifndef _CONSOLE_HPP
 #define _CONSOLE_HPP
 
+#include <algorithm>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -16,34 +18,47 @@
     #include <conio.h>
 #endif
 
+#include "bodystore.hpp"
 #include "camera.hpp"
+#include "gravity.hpp"
+#include "lifecycle.hpp"
+#include "profiler.hpp"
 #include "time.hpp"
 #include "universe.hpp"
 #include "window.hpp"
 
-inline int RunCommand(int& sigIn, int& sigOut, const std::vector<std::string>& args, Universe& universe, Window& window);
+inline int RunCommand(Lifecycle& lifecycle, const std::vector<std::string>& args, Universe& universe, Window& window);
 
 inline int AddBody(Universe& universe);
 inline void FailedConversion();
 inline int Get(const std::vector<std::string>& args, Universe& universe, Window& window);
 inline void InvalidArgCount(int found, int expected);
+inline void PrintPacing(const std::string& name, Time& time);
 inline void InvalidArgCount(int found, int expectedLow, int expectedHigh);
 inline int Set(const std::vector<std::string>& args, Universe& universe, Window& window);
 std::vector<std::string> SplitArguments(const std::string& input);
 
 // TODO: implement linux version for nonblocking IO
 // handles console I/O
-void ConsoleThread(int& sigIn, int& sigOut, Universe& universe, Window& window) {
+void ConsoleThread(Lifecycle& lifecycle, Universe& universe, Window& window) {
     int failVal = 0;
     int inputReady;
     char key;
     std::string input;
     std::vector<std::string> args;
-    while (true) {
+    bool stdinOpen = true;
+    while (lifecycle.IsRunning()) {
 
         #ifdef __linux__
-            struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
-            inputReady = (poll(&pfd, 1, 0));
+            // sleeps until a line comes in or another thread quits, a closed stdin is ignored
+            struct pollfd pfds[2] = {
+                { stdinOpen ? STDIN_FILENO : -1, POLLIN, 0 },
+                { lifecycle.GetStopFd(), POLLIN, 0 }
+            };
+            inputReady = poll(pfds, 2, lifecycle.GetStopFd() >= 0 ? -1 : 50);
+            if (inputReady > 0) {
+                inputReady = (pfds[0].revents & (POLLIN | POLLHUP)) != 0;
+            }
         #endif
         #ifdef _WIN32
             inputReady = _kbhit();
@@ -53,7 +68,10 @@ void ConsoleThread(int& sigIn, int& sigOut, Universe& universe, Window& window)
             if (inputReady == -1) continue;
 
             #ifdef __linux__
-                std::getline(std::cin, input);
+                if (!std::getline(std::cin, input)) {
+                    stdinOpen = false;
+                    continue;
+                }
             #endif
             #ifdef _WIN32
                 key = getch();
@@ -80,20 +98,19 @@ void ConsoleThread(int& sigIn, int& sigOut, Universe& universe, Window& window)
             input = "";
 
             if (args.size() > 0) {
-                RunCommand(sigIn, sigOut, args, universe, window);
+                RunCommand(lifecycle, args, universe, window);
             }
         }
-        if (sigIn <= SUCCESS) {
-            break;
-        }
-        if (sigOut <= SUCCESS) {
-            break;
-        }
-        Time::sleep(0.050);
+        #ifdef _WIN32
+            else {
+                // no console handle to wait on, a stop still cuts the wait short
+                lifecycle.WaitFor(lifecycle.GetGeneration(), 0.050);
+            }
+        #endif
     }
 }
 
-inline int RunCommand(int& sigIn, int& sigOut, const std::vector<std::string>& args, Universe& universe, Window& window) {
+inline int RunCommand(Lifecycle& lifecycle, const std::vector<std::string>& args, Universe& universe, Window& window) {
     if (args[0] == "help") {
         if (args.size() > 1) {
             InvalidArgCount(args.size(), 1);
@@ -103,11 +120,15 @@ inline int RunCommand(int& sigIn, int& sigOut, const std::vector<std::string>& a
         "add - add a new body (further prompts)\n"
         "clear - remove all bodies\n"
         "get - print values of objects or settings\n"
+        "load [file] - replace the universe with a saved checkpoint\n"
         "lock [body] - lock the camera relative to a body\n"
         "pause - pause universe\n"
         "quit - end program\n"
+        "record [file] [every] [p/v/pv] - stream trajectories to a file, record stop ends it\n"
         "remove [name] - remove a body\n"
+        "replay [file] - play a recorded trajectory (pause / resume, set timeScaling), replay seek [s], replay stop\n"
         "resume - unpause universe\n"
+        "save [file] - write every body and setting to a checkpoint\n"
         "set - change values of objects or settings (further prompts)\n"
         "unlock - unbind camera from body it is locked to\n";
     }
@@ -141,12 +162,28 @@ inline int RunCommand(int& sigIn, int& sigOut, const std::vector<std::string>& a
         }
     }
 
+    else if (args[0] == "load") {
+        if (args.size() != 2) {
+            InvalidArgCount(args.size(), 2);
+            return FAIL;
+        }
+        int loaded = universe.LoadCheckpoint(args[1]);
+        if (loaded <= FAIL) {
+            std::cout << "load failed\n";
+            return FAIL;
+        }
+        if (loaded != QUEUED) {
+            std::cout << "loaded " << args[1] << "\n";
+        }
+    }
+
     else if (args[0] == "lock") {
         if (args.size() != 2) {
             InvalidArgCount(args.size(), 2);
             return FAIL;
         }
-        if (window.LockCamera(args[1], universe.GetBodies().at(args[1])) == FAIL) {
+        Body body;
+        if (universe.GetBody(args[1], body) <= FAIL || window.LockCamera(args[1], body) == FAIL) {
             std::cout << "Cannot lock camera to this body\n";
             return FAIL;
         }
@@ -171,10 +208,55 @@ inline int RunCommand(int& sigIn, int& sigOut, const std::vector<std::string>& a
             InvalidArgCount(args.size(), 1);
             return FAIL;
         }
-        sigOut = 0;
+        lifecycle.RequestStop(SUCCESS, "console");
         return SUCCESS;
     }
 
+    else if (args[0] == "record") {
+        if (args.size() < 2 || args.size() > 4) {
+            InvalidArgCount(args.size(), 2, 4);
+            return FAIL;
+        }
+        if (args[1] == "stop") {
+            RecorderStats stats;
+            if (universe.GetRecording(stats) <= FAIL) {
+                return FAIL;
+            }
+            int stopped = universe.StopRecording();
+            if (stopped <= FAIL) {
+                std::cout << "not recording, or the file could not be written\n";
+                return FAIL;
+            }
+            if (stopped != QUEUED) {
+                std::cout << "stopped recording " << stats.path << "\n";
+            }
+            return SUCCESS;
+        }
+        RecorderOptions options;
+        options.path = args[1];
+        try {
+            if (args.size() > 2) {
+                options.decimation = std::stoi(args[2]);
+            }
+        }
+        catch (...) {
+            FailedConversion();
+            return FAIL;
+        }
+        if (args.size() > 3 && ParseTrajectoryFields(args[3], options.fields) <= FAIL) {
+            std::cout << "fields must be p, v or pv\n";
+            return FAIL;
+        }
+        int started = universe.StartRecording(options);
+        if (started <= FAIL) {
+            std::cout << "record failed\n";
+            return FAIL;
+        }
+        if (started != QUEUED) {
+            std::cout << "recording to " << options.path << "\n";
+        }
+    }
+
     else if (args[0] == "remove") {
         if (args.size() != 2) {
             InvalidArgCount(args.size(), 2);
@@ -183,6 +265,58 @@ inline int RunCommand(int& sigIn, int& sigOut, const std::vector<std::string>& a
         universe.RemoveBody(args[1]);
     }
 
+    else if (args[0] == "replay") {
+        if (args.size() < 2 || args.size() > 3) {
+            InvalidArgCount(args.size(), 2, 3);
+            return FAIL;
+        }
+        if (args[1] == "stop" && args.size() == 2) {
+            int closed = universe.CloseReplay();
+            if (closed <= FAIL) {
+                std::cout << "not replaying\n";
+                return FAIL;
+            }
+            if (closed != QUEUED) {
+                std::cout << "replay closed, the bodies stay without masses\n";
+            }
+            return SUCCESS;
+        }
+        if (args[1] == "seek" && args.size() == 3) {
+            double time;
+            try {
+                time = std::stod(args[2]);
+            }
+            catch (...) {
+                FailedConversion();
+                return FAIL;
+            }
+            if (universe.SeekReplay(time) <= FAIL) {
+                std::cout << "seek failed\n";
+                return FAIL;
+            }
+            return SUCCESS;
+        }
+        if (args.size() != 2) {
+            InvalidArgCount(args.size(), 2);
+            return FAIL;
+        }
+        int opened = universe.OpenReplay(args[1]);
+        if (opened <= FAIL) {
+            std::cout << "replay failed\n";
+            return FAIL;
+        }
+        if (opened == QUEUED) {
+            return SUCCESS;
+        }
+        ReplayStats stats;
+        if (universe.GetReplay(stats) <= FAIL) {
+            std::cout << "replaying " << args[1] << "\n";
+            return SUCCESS;
+        }
+        std::cout << "replaying " << args[1] << ", " << stats.frames << " frames from " << stats.firstTime
+        << " s to " << stats.lastTime << " s\n";
+    }
+
     else if (args[0] == "resume" || args[0] == "unpause") {
         if (args.size() != 1) {
             InvalidArgCount(args.size(), 1);
@@ -196,6 +330,21 @@ inline int RunCommand(int& sigIn, int& sigOut, const std::vector<std::string>& a
         }
     }
 
+    else if (args[0] == "save") {
+        if (args.size() != 2) {
+            InvalidArgCount(args.size(), 2);
+            return FAIL;
+        }
+        int saved = universe.SaveCheckpoint(args[1]);
+        if (saved <= FAIL) {
+            std::cout << "save failed\n";
+            return FAIL;
+        }
+        if (saved != QUEUED) {
+            std::cout << "saved " << args[1] << "\n";
+        }
+    }
+
     else if (args[0] == "set") {
         if (args.size() > 7) {
             InvalidArgCount(args.size(), 1, 6);
@@ -343,13 +492,29 @@ inline int Get(const std::vector<std::string>& args, Universe& universe, Window&
     std::vector<std::string> input;
     if (args.size() == 1) {
         std::cout << "choices: "
+        "blockLevels\n"
         "bodies\n"
         "body [name]\n"
         "camera\n"
+        "collisions\n"
         "cScaling\n"
+        "energy\n"
+        "fmmOrder\n"
+        "fmmTheta\n"
         "gravityScaling\n"
+        "integrator\n"
         "isPaused\n"
+        "kernel\n"
+        "pacing\n"
+        "recording\n"
+        "renderMode\n"
+        "replay\n"
+        "solver\n"
+        "solverError\n"
+        "stats\n"
         "targetFramerate\n"
+        "theta\n"
+        "threads\n"
         "tickSpeed\n"
         "timeScaling\n"
         "input selection: ";
@@ -363,9 +528,21 @@ inline int Get(const std::vector<std::string>& args, Universe& universe, Window&
         input = args;
     }
 
-    if (input[1] == "bodies") {
-        const auto bodies = universe.GetBodies();
-        for (const auto [name, data]: bodies) {
+    if (input[1] == "blockLevels") {
+        int levels = universe.GetBlockLevels();
+        long long evaluations = universe.GetBlockEvaluations();
+        if (levels <= FAIL || evaluations <= FAIL) {
+            return FAIL;
+        }
+        std::cout << "blockLevels = " << levels << " (" << evaluations << " body evaluations last tick)\n";
+    }
+
+    else if (input[1] == "bodies") {
+        BodyStore bodies;
+        universe.CopyBodies(bodies);
+        std::vector<std::string> names = bodies.names;
+        std::sort(names.begin(), names.end());
+        for (const auto& name: names) {
             std::cout << name << "\n";
         }
     }
@@ -375,10 +552,10 @@ inline int Get(const std::vector<std::string>& args, Universe& universe, Window&
             InvalidArgCount(input.size(), 3);
             return FAIL;
         }
-        if (universe.GetBodies().find(input[2]) == universe.GetBodies().end()) {
+        Body body;
+        if (universe.GetBody(input[2], body) <= FAIL) {
             return FAIL;
         }
-        const Body body = universe.GetBodies().at(input[2]);
         std::cout << "Body: " << body.name << "\n"
         "Coordinates: " << body.x / SCALE << " " << body.y / SCALE << " " << body.z / SCALE << "\n"
         "Directional Velocities: " << body.xVel / SCALE << " " << body.yVel / SCALE << " " << body.zVel / SCALE << "\n"
@@ -403,22 +580,153 @@ inline int Get(const std::vector<std::string>& args, Universe& universe, Window&
         }
     }
 
+    else if (input[1] == "collisions") {
+        std::string response = universe.GetCollisions();
+        long long contacts = universe.GetLastContacts();
+        if (response == "" || contacts <= FAIL) {
+            return FAIL;
+        }
+        std::cout << "collisions = " << response << " (" << contacts << " contacts last tick)\n";
+    }
+
     else if (input[1] == "cScaling") {
         std::cout << "cScaling = " << universe.GetcScaling() << "\n";
     }
 
+    else if (input[1] == "energy") {
+        ConservationStats stats;
+        int interval = universe.GetEnergyInterval();
+        if (universe.GetConservation(stats) <= FAIL || interval <= FAIL) {
+            return FAIL;
+        }
+        std::cout << "tick " << stats.tick << ", potential every " << interval << " ticks\n";
+        if (stats.hasEnergy) {
+            std::cout << "energy = " << stats.energy << " (kinetic " << stats.kinetic << ", potential " << stats.potential
+            << " at tick " << stats.energyTick << ")\n"
+            "  drift " << stats.energyDrift << ", max " << stats.maxEnergyDrift << "\n";
+        }
+        std::cout << "momentum = " << stats.momentum[0] << " " << stats.momentum[1] << " " << stats.momentum[2] << "\n"
+        "  drift " << stats.momentumDrift << ", max " << stats.maxMomentumDrift << "\n"
+        "angularMomentum = " << stats.angularMomentum[0] << " " << stats.angularMomentum[1] << " " << stats.angularMomentum[2] << "\n"
+        "  drift " << stats.angularMomentumDrift << ", max " << stats.maxAngularMomentumDrift << "\n";
+    }
+
+    else if (input[1] == "fmmOrder") {
+        int order = universe.GetFmmOrder();
+        if (order <= FAIL) {
+            return FAIL;
+        }
+        std::cout << "fmmOrder = " << order << "\n";
+    }
+
+    else if (input[1] == "fmmTheta") {
+        double theta = universe.GetFmmOpeningAngle();
+        if (theta <= FAIL) {
+            return FAIL;
+        }
+        std::cout << "fmmTheta = " << theta << "\n";
+    }
+
     else if (input[1] == "gravityScaling") {
         std::cout << "gravityScaling = " << universe.GetGravityScaling() << "\n";
     }
 
+    else if (input[1] == "integrator") {
+        std::cout << "integrator = " << universe.GetIntegrator() << "\n";
+    }
+
+    else if (input[1] == "kernel") {
+        std::cout << "kernel = " << GetGravityKernel() << "\n";
+    }
+
     else if (input[1] == "isPaused") {
         std::cout << "isPaused = " << universe.IsPaused() << "\n";
     }
 
+    else if (input[1] == "pacing") {
+        // since the last query
+        PrintPacing("physics", universe.time);
+        PrintPacing("render", window.time);
+    }
+
+    else if (input[1] == "recording") {
+        RecorderStats stats;
+        if (universe.GetRecording(stats) <= FAIL) {
+            return FAIL;
+        }
+        if (!stats.recording) {
+            std::cout << "not recording\n";
+            return SUCCESS;
+        }
+        double ratio = stats.bytes > 0 ? (double)stats.rawBytes / stats.bytes : 0.0;
+        std::cout << "recording to " << stats.path << (stats.failed ? " (write failed)" : "") << "\n"
+        "  " << stats.frames << " frames, " << stats.dropped << " dropped, " << stats.chunks << " chunks\n"
+        "  " << stats.bytes << " bytes, " << ratio << "x smaller than raw\n";
+    }
+
+    else if (input[1] == "renderMode") {
+        std::cout << "renderMode = " << window.GetRenderMode() << "\n";
+    }
+
+    else if (input[1] == "replay") {
+        ReplayStats stats;
+        if (universe.GetReplay(stats) <= FAIL) {
+            return FAIL;
+        }
+        if (!stats.replaying) {
+            std::cout << "not replaying\n";
+            return SUCCESS;
+        }
+        std::cout << "replaying " << stats.path << (stats.indexed ? "" : " (no index, chunks scanned)") << "\n"
+        "  " << stats.frames << " frames in " << stats.chunks << " chunks, " << stats.firstTime << " s to " << stats.lastTime << " s\n"
+        "  at tick " << stats.tick << ", " << stats.time << " s" << (universe.IsPaused() ? " (paused)" : "") << "\n";
+    }
+
     else if (input[1] == "targetFramerate") {
         std::cout << "targetFramerate = " << window.time.GetTickSpeed() << "\n";
     }
 
+    else if (input[1] == "solver") {
+        std::cout << "solver = " << universe.GetSolver() << "\n";
+    }
+
+    else if (input[1] == "solverError") {
+        SolverError error;
+        if (universe.EstimateSolverError(error) <= FAIL) {
+            return FAIL;
+        }
+        std::cout << "solverError (" << universe.GetSolver() << ", relative to exact) = rms " << error.rms << ", max " << error.max << "\n";
+    }
+
+    else if (input[1] == "stats") {
+        PrintProfile(std::cout);
+        RenderStats render = window.GetRenderStats();
+        std::cout << "last frame: " << render.visible << " bodies visible, " << render.culled << " culled\n"
+        "  per sphere level";
+        for (int level = 0; level < sphereLodCount; level++) {
+            std::cout << " " << render.levels[level];
+        }
+        std::cout << ", impostors " << render.levels[impostorLevel] << "\n"
+        "  instance uploads: " << render.upload.reallocations << " reallocations, " << render.upload.stalls << " stalls"
+        << (render.upload.orphaning ? " (orphaning, mapping failed)" : "") << "\n";
+    }
+
+    else if (input[1] == "theta") {
+        double theta = universe.GetOpeningAngle();
+        if (theta <= FAIL) {
+            return FAIL;
+        }
+        std::cout << "theta = " << theta << "\n";
+    }
+
+    else if (input[1] == "threads") {
+        int threads = universe.GetThreadCount();
+        if (threads <= FAIL) {
+            return FAIL;
+        }
+        std::cout << "threads = " << threads << "\n";
+    }
+
     else if (input[1] == "tickSpeed") {
         std::cout << "tickSpeed = " << universe.GetTickSpeed() << "\n";
     }
@@ -443,6 +751,15 @@ inline void InvalidArgCount(int found, int expectedLow, int expectedHigh) {
     std::cout << "Invalid argument count. Found: " << found << ", Expected: " << expectedLow << " to " << expectedHigh << "\n";
 }
 
+inline void PrintPacing(const std::string& name, Time& time) {
+    PacingStats stats = time.GetPacingStats();
+    time.ResetPacingStats();
+    std::cout << name << " pacing = " << time.GetTickSpeed() << " Hz, "
+    << (time.GetLatePolicy() == LatePolicy::drop ? "drop" : "catchup") << ", spin " << time.GetSpinMargin() * 1e6 << " us\n"
+    "  jitter mean " << stats.meanJitter * 1e6 << " us, max " << stats.maxJitter * 1e6 << " us\n"
+    "  " << stats.late << " late, " << stats.dropped << " dropped of " << stats.ticks << " ticks\n";
+}
+
 inline int SetBody(std::vector<std::string>& input, Universe& universe) {
     std::string sval;
     if (input.size() == 2) {
@@ -450,7 +767,8 @@ inline int SetBody(std::vector<std::string>& input, Universe& universe) {
         std::getline(std::cin, sval);
         input.push_back(sval);
     }
-    if (universe.GetBodies().find(input[2]) == universe.GetBodies().end()) {
+    Body existing;
+    if (universe.GetBody(input[2], existing) <= FAIL) {
         return FAIL;
     }
     if (input.size() == 3) {
@@ -476,7 +794,8 @@ inline int SetBody(std::vector<std::string>& input, Universe& universe) {
         }
     }
 
-    Body* body = &universe.GetBodiesMut().at(input[2]);
+    // values are parsed first, then applied to the live body in one update
+    std::function<void(Body&)> update;
 
     if (input[3] == "coordinates") {
         if (input.size() != 7) {
@@ -492,9 +811,11 @@ inline int SetBody(std::vector<std::string>& input, Universe& universe) {
         catch (...) {
             return FAIL;
         }
-        body->x = x;
-        body->y = y;
-        body->z = z;
+        update = [=](Body& body) {
+            body.x = x;
+            body.y = y;
+            body.z = z;
+        };
     }
     else if (input[3] == "directionalVelocities") {
         if (input.size() != 7) {
@@ -510,9 +831,11 @@ inline int SetBody(std::vector<std::string>& input, Universe& universe) {
         catch (...) {
             return FAIL;
         }
-        body->xVel = xVel;
-        body->yVel = yVel;
-        body->zVel = zVel;
+        update = [=](Body& body) {
+            body.xVel = xVel;
+            body.yVel = yVel;
+            body.zVel = zVel;
+        };
     }
     else if (input[3] == "velocity") {
         if (input.size() != 5) {
@@ -526,11 +849,13 @@ inline int SetBody(std::vector<std::string>& input, Universe& universe) {
         catch (...) {
             return FAIL;
         }
-        double currentVelocity = sqrt((body->xVel * body->xVel) + (body->yVel * body->yVel) + (body->zVel * body->zVel));
-        double velocityRatio = velocity / currentVelocity;
-        body->xVel *= velocityRatio;
-        body->yVel *= velocityRatio;
-        body->zVel *= velocityRatio;
+        update = [=](Body& body) {
+            double currentVelocity = sqrt((body.xVel * body.xVel) + (body.yVel * body.yVel) + (body.zVel * body.zVel));
+            double velocityRatio = velocity / currentVelocity;
+            body.xVel *= velocityRatio;
+            body.yVel *= velocityRatio;
+            body.zVel *= velocityRatio;
+        };
     }
     else if (input[3] == "radius") {
         if (input.size() != 5) {
@@ -544,7 +869,7 @@ inline int SetBody(std::vector<std::string>& input, Universe& universe) {
         catch (...) {
             return FAIL;
         }
-        body->radius = radius;
+        update = [=](Body& body) { body.radius = radius; };
     }
     else if (input[3] == "mass") {
         if (input.size() != 5) {
@@ -558,7 +883,7 @@ inline int SetBody(std::vector<std::string>& input, Universe& universe) {
         catch (...) {
             return FAIL;
         }
-        body->mass = mass;
+        update = [=](Body& body) { body.mass = mass; };
     }
     else if (input[3] == "luminosity") {
         if (input.size() != 5) {
@@ -576,7 +901,7 @@ inline int SetBody(std::vector<std::string>& input, Universe& universe) {
             std::cout << "out of range\n";
             return FAIL;
         }
-        body->luminosity = luminosity;
+        update = [=](Body& body) { body.luminosity = luminosity; };
     }
     else if (input[3] == "color") {
         if (input.size() != 7) {
@@ -596,15 +921,17 @@ inline int SetBody(std::vector<std::string>& input, Universe& universe) {
             std::cout << "out of range\n";
             return FAIL;
         }
-        body->red = r;
-        body->green = g;
-        body->blue = b;
+        update = [=](Body& body) {
+            body.red = r;
+            body.green = g;
+            body.blue = b;
+        };
     }
     else {
         return FAIL;
     }
 
-    return SUCCESS;
+    return universe.UpdateBody(input[2], update);
 }
 
 inline int SetCamera(std::vector<std::string>& input, Window& window) {
@@ -716,11 +1043,24 @@ inline int Set(const std::vector<std::string>& args, Universe& universe, Window&
     std::vector<std::string> input;
     if (args.size() == 1) {
         std::cout << "choices:\n"
+        "blockLevels [value]\n"
         "body [name]\n"
         "camera\n"
+        "collisions [off/log/bounce/merge]\n"
         "cScaling [value]\n"
+        "energyInterval [ticks, 0 = off]\n"
+        "fmmOrder [1 to 8]\n"
+        "fmmTheta [0 to 1)\n"
         "gravityScaling [value]\n"
+        "integrator [euler/leapfrog/yoshida4/forestruth/block]\n"
+        "kernel [scalar/avx2/avx512]\n"
+        "pacing [catchup/drop]\n"
+        "renderMode [spheres/points]\n"
+        "solver [direct/symmetric/barneshut/fmm]\n"
+        "spinMargin [us]\n"
         "targetFramerate [value]\n"
+        "theta [value]\n"
+        "threads [value]\n"
         "tickSpeed [value]\n"
         "timeScaling [value]\n"
         "input selection: ";
@@ -757,13 +1097,79 @@ inline int Set(const std::vector<std::string>& args, Universe& universe, Window&
     else {
         sval = input[2];
     }
+    // non-numeric settings
+    if (input[1] == "solver") {
+        if (universe.SetSolver(sval) <= FAIL) {
+            std::cout << "unknown solver: " << sval << "\n";
+            return FAIL;
+        }
+        return SUCCESS;
+    }
+
+    if (input[1] == "collisions") {
+        if (universe.SetCollisions(sval) <= FAIL) {
+            std::cout << "unknown collision response: " << sval << "\n";
+            return FAIL;
+        }
+        return SUCCESS;
+    }
+
+    if (input[1] == "integrator") {
+        if (universe.SetIntegrator(sval) <= FAIL) {
+            std::cout << "unknown integrator: " << sval << "\n";
+            return FAIL;
+        }
+        return SUCCESS;
+    }
+
+    if (input[1] == "pacing") {
+        LatePolicy policy;
+        if (sval == "catchup") {
+            policy = LatePolicy::catchUp;
+        }
+        else if (sval == "drop") {
+            policy = LatePolicy::drop;
+        }
+        else {
+            std::cout << "unknown pacing policy: " << sval << "\n";
+            return FAIL;
+        }
+        universe.time.SetLatePolicy(policy);
+        window.time.SetLatePolicy(policy);
+        return SUCCESS;
+    }
+
+    if (input[1] == "renderMode") {
+        if (window.SetRenderMode(sval) <= FAIL) {
+            std::cout << "unknown render mode: " << sval << "\n";
+            return FAIL;
+        }
+        return SUCCESS;
+    }
+
+    if (input[1] == "kernel") {
+        if (SetGravityKernel(sval) <= FAIL) {
+            std::cout << "unsupported kernel: " << sval << "\n";
+            return FAIL;
+        }
+        return SUCCESS;
+    }
+
     try { value = std::stod(sval); }
     catch (...) { return FAIL; }
 
+    if (input[1] == "blockLevels") {
+        return universe.SetBlockLevels((int)value);
+    }
+
     if (input[1] == "cScaling") {
         return universe.SetcScaling(value);
     }
 
+    if (input[1] == "energyInterval") {
+        return universe.SetEnergyInterval((int)value);
+    }
+
     if (input[1] == "gravityScaling") {
         return universe.SetGravityScaling(value);
     }
@@ -772,6 +1178,30 @@ inline int Set(const std::vector<std::string>& args, Universe& universe, Window&
         return window.time.SetTickSpeed(value);
     }
 
+    else if (input[1] == "fmmOrder") {
+        return universe.SetFmmOrder((int)value);
+    }
+
+    else if (input[1] == "fmmTheta") {
+        return universe.SetFmmOpeningAngle(value);
+    }
+
+    else if (input[1] == "spinMargin") {
+        if (universe.time.SetSpinMargin(value * 1e-6) <= FAIL || window.time.SetSpinMargin(value * 1e-6) <= FAIL) {
+            std::cout << "spinMargin must be 0 to 10000 us\n";
+            return FAIL;
+        }
+        return SUCCESS;
+    }
+
+    else if (input[1] == "theta") {
+        return universe.SetOpeningAngle(value);
+    }
+
+    else if (input[1] == "threads") {
+        return universe.SetThreadCount((int)value);
+    }
+
     else if (input[1] == "tickSpeed") {
         return universe.SetTickSpeed(value);
     }
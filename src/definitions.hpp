@@ -2,10 +2,17 @@
 #ifndef _DEFINITIONS_HPP
 #define _DEFINITIONS_HPP
 
+#include <cstdint>
+
 #define SUCCESS 0
 #define FAIL -1
+// a command timed out waiting for the physics thread, it still runs at a later tick boundary
+#define QUEUED 1
 
 #define SCALE 1e-9
 #define RADIUS_SCALE 100.0
 
+// stored as a number in binary file headers, reads back differently on a machine with the other byte order
+constexpr uint32_t byteOrderMark = 0x01020304;
+
 #endif
\ No newline at end of file
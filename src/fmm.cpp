@@ -0,0 +1,424 @@
+#include "fmm.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "definitions.hpp"
+#include "gravity.hpp"
+#include "octree.hpp"
+#include "threadpool.hpp"
+#include "values.hpp"
+
+// coefficients of a maxOrder expansion: (p + 1)(p + 2)(p + 3) / 6
+constexpr int maxCoefficients = (FmmSolver::maxOrder + 1) * (FmmSolver::maxOrder + 2) * (FmmSolver::maxOrder + 3) / 6;
+
+// binomial coefficient of two multi-indices (a, b, c) choose (d, e, f)
+inline double Binomial3(const std::vector<std::vector<double>>& binomials, const int* n, const int* k) {
+    return binomials[n[0]][k[0]] * binomials[n[1]][k[1]] * binomials[n[2]][k[2]];
+}
+
+
+// private
+
+void FmmSolver::BuildTables() {
+    int p = _order;
+    // multi-indices ordered by degree
+    std::vector<int> indices;
+    std::vector<int> lookup((p + 1) * (p + 1) * (p + 1), -1);
+    auto at = [&](int a, int b, int c) {
+        if (a < 0 || b < 0 || c < 0 || a + b + c > p) {
+            return -1;
+        }
+        return lookup[(a * (p + 1) + b) * (p + 1) + c];
+    };
+    for (int d = 0; d <= p; d++) {
+        for (int a = d; a >= 0; a--) {
+            for (int b = d - a; b >= 0; b--) {
+                lookup[(a * (p + 1) + b) * (p + 1) + (d - a - b)] = indices.size() / 3;
+                indices.push_back(a);
+                indices.push_back(b);
+                indices.push_back(d - a - b);
+            }
+        }
+    }
+    _coefficientCount = indices.size() / 3;
+
+    std::vector<std::vector<double>> binomials(p + 1, std::vector<double>(p + 1, 0.0));
+    for (int n = 0; n <= p; n++) {
+        binomials[n][0] = 1.0;
+        for (int k = 1; k <= n; k++) {
+            binomials[n][k] = binomials[n - 1][k - 1] + (k <= n - 1 ? binomials[n - 1][k] : 0.0);
+        }
+    }
+
+    _degree.assign(_coefficientCount, 0);
+    _parent.assign(_coefficientCount, -1);
+    _parentAxis.assign(_coefficientCount, 0);
+    _minusOne.assign(_coefficientCount * 3, -1);
+    _minusTwo.assign(_coefficientCount * 3, -1);
+    for (int i = 0; i < _coefficientCount; i++) {
+        const int* n = &indices[i * 3];
+        _degree[i] = n[0] + n[1] + n[2];
+        for (int axis = 0; axis < 3; axis++) {
+            int one[3] = { n[0], n[1], n[2] };
+            one[axis] -= 1;
+            int two[3] = { n[0], n[1], n[2] };
+            two[axis] -= 2;
+            _minusOne[i * 3 + axis] = at(one[0], one[1], one[2]);
+            _minusTwo[i * 3 + axis] = at(two[0], two[1], two[2]);
+            if (_parent[i] == -1 && _minusOne[i * 3 + axis] != -1) {
+                _parent[i] = _minusOne[i * 3 + axis];
+                _parentAxis[i] = axis;
+            }
+        }
+    }
+
+    _m2m.clear();
+    _m2l.clear();
+    _l2l.clear();
+    for (int axis = 0; axis < 3; axis++) {
+        _l2p[axis].clear();
+    }
+    for (int i = 0; i < _coefficientCount; i++) {
+        const int* n = &indices[i * 3];
+        for (int j = 0; j < _coefficientCount; j++) {
+            const int* k = &indices[j * 3];
+            // k <= n componentwise
+            int difference = at(n[0] - k[0], n[1] - k[1], n[2] - k[2]);
+            if (difference != -1) {
+                // M[n] += C(n, k) M'[k] t^(n - k)
+                _m2m.push_back({ (uint16_t)i, (uint16_t)j, (uint16_t)difference, Binomial3(binomials, n, k) });
+                // L'[k] += C(n, k) L[n] t^(n - k)
+                _l2l.push_back({ (uint16_t)j, (uint16_t)i, (uint16_t)difference, Binomial3(binomials, n, k) });
+            }
+            // L[k] += (-1)^|n| C(n + k, n) M[n] T[n + k]
+            int sum = at(n[0] + k[0], n[1] + k[1], n[2] + k[2]);
+            if (sum != -1) {
+                int total[3] = { n[0] + k[0], n[1] + k[1], n[2] + k[2] };
+                double sign = (_degree[i] % 2) ? -1.0 : 1.0;
+                _m2l.push_back({ (uint16_t)j, (uint16_t)i, (uint16_t)sum, sign * Binomial3(binomials, total, n) });
+            }
+        }
+        // d/dx_axis of L[n] s^n = n_axis L[n] s^(n - e_axis)
+        for (int axis = 0; axis < 3; axis++) {
+            if (n[axis] > 0) {
+                _l2p[axis].push_back({ (uint16_t)axis, (uint16_t)i, (uint16_t)_minusOne[i * 3 + axis], (double)n[axis] });
+            }
+        }
+    }
+}
+
+void FmmSolver::Powers(double x, double y, double z, double* powers) const {
+    const double components[3] = { x, y, z };
+    powers[0] = 1.0;
+    for (int i = 1; i < _coefficientCount; i++) {
+        powers[i] = powers[_parent[i]] * components[_parentAxis[i]];
+    }
+}
+
+// taylor coefficients D^n(1 / r) / n! of every multi-index at r = (x, y, z)
+// recurrence from Lindsay & Krasny (2001), using v = -r
+void FmmSolver::Derivatives(double x, double y, double z, double* derivatives) const {
+    const double v[3] = { -x, -y, -z };
+    double r2 = (x * x) + (y * y) + (z * z);
+    derivatives[0] = 1.0 / sqrt(r2);
+    for (int i = 1; i < _coefficientCount; i++) {
+        int n = _degree[i];
+        double first = 0.0, second = 0.0;
+        for (int axis = 0; axis < 3; axis++) {
+            int one = _minusOne[i * 3 + axis];
+            int two = _minusTwo[i * 3 + axis];
+            if (one != -1) {
+                first += v[axis] * derivatives[one];
+            }
+            if (two != -1) {
+                second += derivatives[two];
+            }
+        }
+        derivatives[i] = (((2 * n - 1) * first) - ((n - 1) * second)) / (n * r2);
+    }
+}
+
+// multipoles and radii, children before parents
+void FmmSolver::Upward() {
+    double powers[maxCoefficients];
+    for (size_t i = _tree.nodes.size(); i-- > 0;) {
+        const OctreeNode& node = _tree.nodes[i];
+        double* multipole = &_multipoles[i * _coefficientCount];
+        double radius = 0.0;
+        if (node.childCount == 0) {
+            for (uint32_t b = node.bodyBegin; b < node.bodyEnd; b++) {
+                double dx = _tree.x[b] - node.comX;
+                double dy = _tree.y[b] - node.comY;
+                double dz = _tree.z[b] - node.comZ;
+                radius = std::max(radius, sqrt((dx * dx) + (dy * dy) + (dz * dz)));
+                Powers(dx, dy, dz, powers);
+                for (int n = 0; n < _coefficientCount; n++) {
+                    multipole[n] += _tree.mass[b] * powers[n];
+                }
+            }
+        }
+        else {
+            for (uint32_t c = node.childBegin; c < node.childBegin + node.childCount; c++) {
+                const OctreeNode& child = _tree.nodes[c];
+                const double* childMultipole = &_multipoles[c * _coefficientCount];
+                double tx = child.comX - node.comX;
+                double ty = child.comY - node.comY;
+                double tz = child.comZ - node.comZ;
+                radius = std::max(radius, _radius[c] + sqrt((tx * tx) + (ty * ty) + (tz * tz)));
+                Powers(tx, ty, tz, powers);
+                for (const Term& term: _m2m) {
+                    multipole[term.target] += term.factor * childMultipole[term.source] * powers[term.power];
+                }
+            }
+        }
+        _radius[i] = radius;
+    }
+}
+
+void FmmSolver::Evaluate(const GravityParams& params, ThreadPool& pool) {
+    // split the tree into disjoint subtrees, a few per thread
+    _tasks.assign(1, 0);
+    size_t wanted = 8 * pool.GetThreadCount();
+    while (_tasks.size() < wanted) {
+        std::vector<uint32_t> next;
+        bool split = false;
+        for (uint32_t task: _tasks) {
+            const OctreeNode& node = _tree.nodes[task];
+            if (node.childCount == 0) {
+                next.push_back(task);
+                continue;
+            }
+            for (uint32_t c = node.childBegin; c < node.childBegin + node.childCount; c++) {
+                next.push_back(c);
+            }
+            split = true;
+        }
+        _tasks = next;
+        if (!split) {
+            break;
+        }
+    }
+
+    // each subtree only receives into its own nodes and bodies
+    pool.ParallelFor(_tasks.size(), [&](int thread, size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            Interact(_tasks[t], 0, params);
+            Downward(_tasks[t]);
+        }
+    });
+}
+
+void FmmSolver::Near(const OctreeNode& target, const OctreeNode& source, const GravityParams& params) {
+    if (_potentialPass) {
+        for (uint32_t b = target.bodyBegin; b < target.bodyEnd; b++) {
+            double sum = 0.0;
+            for (uint32_t s = source.bodyBegin; s < source.bodyEnd; s++) {
+                double dx = _tree.x[s] - _tree.x[b];
+                double dy = _tree.y[s] - _tree.y[b];
+                double dz = _tree.z[s] - _tree.z[b];
+                double distanceSquared = (dx * dx) + (dy * dy) + (dz * dz);
+                // same cutoff as the force kernels, also skips the body itself
+                if (distanceSquared < 1e-36) {
+                    continue;
+                }
+                sum += _tree.mass[s] / sqrt(distanceSquared);
+            }
+            _potential[b] += sum;
+        }
+        return;
+    }
+    GravitySources sources = { _tree.x.data(), _tree.y.data(), _tree.z.data(), _tree.mass.data(), _tree.x.size() };
+    for (uint32_t b = target.bodyBegin; b < target.bodyEnd; b++) {
+        AccumulateAcceleration(sources, source.bodyBegin, source.bodyEnd, _tree.x[b], _tree.y[b], _tree.z[b], params, _xAcc[b], _yAcc[b], _zAcc[b]);
+    }
+}
+
+// adds the field of sourceNode's bodies to targetNode's bodies
+void FmmSolver::Interact(uint32_t targetNode, uint32_t sourceNode, const GravityParams& params) {
+    const OctreeNode& target = _tree.nodes[targetNode];
+    const OctreeNode& source = _tree.nodes[sourceNode];
+    bool targetLeaf = target.childCount == 0;
+    bool sourceLeaf = source.childCount == 0;
+
+    if (targetNode == sourceNode) {
+        if (targetLeaf) {
+            Near(target, source, params);
+            return;
+        }
+        for (uint32_t a = target.childBegin; a < target.childBegin + target.childCount; a++) {
+            for (uint32_t b = target.childBegin; b < target.childBegin + target.childCount; b++) {
+                Interact(a, b, params);
+            }
+        }
+        return;
+    }
+
+    double rx = target.comX - source.comX;
+    double ry = target.comY - source.comY;
+    double rz = target.comZ - source.comZ;
+    double distance = sqrt((rx * rx) + (ry * ry) + (rz * rz));
+    if (_radius[targetNode] + _radius[sourceNode] < _theta * distance) {
+        // well separated, source multipole -> target local
+        double derivatives[maxCoefficients];
+        Derivatives(rx, ry, rz, derivatives);
+        double* local = &_locals[targetNode * _coefficientCount];
+        const double* multipole = &_multipoles[sourceNode * _coefficientCount];
+        for (const Term& term: _m2l) {
+            local[term.target] += term.factor * multipole[term.source] * derivatives[term.power];
+        }
+        return;
+    }
+
+    if (targetLeaf && sourceLeaf) {
+        Near(target, source, params);
+        return;
+    }
+
+    // split the larger node
+    if (sourceLeaf || (!targetLeaf && _radius[targetNode] >= _radius[sourceNode])) {
+        for (uint32_t a = target.childBegin; a < target.childBegin + target.childCount; a++) {
+            Interact(a, sourceNode, params);
+        }
+    }
+    else {
+        for (uint32_t b = source.childBegin; b < source.childBegin + source.childCount; b++) {
+            Interact(targetNode, b, params);
+        }
+    }
+}
+
+// pushes locals down the subtree and evaluates them at the bodies
+void FmmSolver::Downward(uint32_t root) {
+    double powers[maxCoefficients];
+    std::vector<uint32_t> stack = { root };
+    while (stack.size() > 0) {
+        uint32_t nodeIndex = stack.back();
+        stack.pop_back();
+        const OctreeNode& node = _tree.nodes[nodeIndex];
+        const double* local = &_locals[nodeIndex * _coefficientCount];
+        if (node.childCount == 0) {
+            for (uint32_t b = node.bodyBegin; b < node.bodyEnd; b++) {
+                Powers(_tree.x[b] - node.comX, _tree.y[b] - node.comY, _tree.z[b] - node.comZ, powers);
+                if (_potentialPass) {
+                    double potential = 0.0;
+                    for (int n = 0; n < _coefficientCount; n++) {
+                        potential += local[n] * powers[n];
+                    }
+                    _potential[b] += potential;
+                    continue;
+                }
+                double acceleration[3] = { 0.0, 0.0, 0.0 };
+                for (int axis = 0; axis < 3; axis++) {
+                    for (const Term& term: _l2p[axis]) {
+                        acceleration[axis] += term.factor * local[term.source] * powers[term.power];
+                    }
+                }
+                _xAcc[b] += acceleration[0] * _farScale;
+                _yAcc[b] += acceleration[1] * _farScale;
+                _zAcc[b] += acceleration[2] * _farScale;
+            }
+            continue;
+        }
+        for (uint32_t c = node.childBegin; c < node.childBegin + node.childCount; c++) {
+            const OctreeNode& child = _tree.nodes[c];
+            double* childLocal = &_locals[c * _coefficientCount];
+            Powers(child.comX - node.comX, child.comY - node.comY, child.comZ - node.comZ, powers);
+            for (const Term& term: _l2l) {
+                childLocal[term.target] += term.factor * local[term.source] * powers[term.power];
+            }
+            stack.push_back(c);
+        }
+    }
+}
+
+
+// public
+
+FmmSolver::FmmSolver() {
+    _order = 4;
+    _theta = 0.5;
+    _leafSize = 64;
+    _farScale = G;
+    _potentialPass = false;
+    BuildTables();
+}
+
+const char* FmmSolver::GetName() const {
+    return "fmm";
+}
+
+int FmmSolver::ComputeAccelerations(BodyStore& bodies, const GravityParams& params, ThreadPool& pool) {
+    size_t count = bodies.Size();
+    _tree.Build(bodies, _leafSize);
+    size_t nodeCount = _tree.nodes.size();
+    _radius.assign(nodeCount, 0.0);
+    _multipoles.assign(nodeCount * _coefficientCount, 0.0);
+    _locals.assign(nodeCount * _coefficientCount, 0.0);
+    _xAcc.assign(count, 0.0);
+    _yAcc.assign(count, 0.0);
+    _zAcc.assign(count, 0.0);
+    _farScale = G * params.gravityScaling;
+
+    Upward();
+    Evaluate(params, pool);
+
+    for (size_t k = 0; k < count; k++) {
+        size_t i = _tree.order[k];
+        bodies.xAcc[i] = _xAcc[k];
+        bodies.yAcc[i] = _yAcc[k];
+        bodies.zAcc[i] = _zAcc[k];
+    }
+    return SUCCESS;
+}
+
+double FmmSolver::ComputePotential(const BodyStore& bodies, const GravityParams& params, ThreadPool& pool) {
+    size_t count = bodies.Size();
+    _tree.Build(bodies, _leafSize);
+    size_t nodeCount = _tree.nodes.size();
+    _radius.assign(nodeCount, 0.0);
+    _multipoles.assign(nodeCount * _coefficientCount, 0.0);
+    _locals.assign(nodeCount * _coefficientCount, 0.0);
+    _potential.assign(count, 0.0);
+
+    _potentialPass = true;
+    Upward();
+    Evaluate(params, pool);
+    _potentialPass = false;
+
+    // summed in tree order, so the result does not depend on scheduling
+    double potential = 0.0;
+    for (size_t k = 0; k < count; k++) {
+        potential -= _tree.mass[k] * _potential[k];
+    }
+    // every pair was seen from both ends
+    return 0.5 * G * params.gravityScaling * potential;
+}
+
+int FmmSolver::GetOrder() const {
+    return _order;
+}
+
+int FmmSolver::SetOrder(int order) {
+    if (order < 1 || order > maxOrder) {
+        return FAIL;
+    }
+    _order = order;
+    BuildTables();
+    return SUCCESS;
+}
+
+double FmmSolver::GetOpeningAngle() const {
+    return _theta;
+}
+
+int FmmSolver::SetOpeningAngle(double theta) {
+    // above 1 a node could accept its own ancestor
+    if (theta < 0.0 || theta >= 1.0) {
+        return FAIL;
+    }
+    _theta = theta;
+    return SUCCESS;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef _FMM_HPP
+#define _FMM_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "gravity.hpp"
+#include "octree.hpp"
+#include "solver.hpp"
+#include "threadpool.hpp"
+
+// fast multipole method with cartesian taylor expansions
+// multipoles are built up the octree, translated into local expansions between
+// well separated nodes (rA + rB < theta * distance) and pushed back down to the bodies
+// the far field is newtonian, the relativity factor is only applied between near bodies
+class FmmSolver : public Solver {
+    // one term of a translation: out[target] += factor * in[source] * powers[power]
+    struct Term {
+        uint16_t target, source, power;
+        double factor;
+    };
+
+    Octree _tree;
+    // expansion center (center of mass) to farthest body, per node
+    std::vector<double> _radius;
+    // coefficients per node, _coefficientCount each
+    std::vector<double> _multipoles;
+    std::vector<double> _locals;
+    // accelerations in tree order
+    std::vector<double> _xAcc, _yAcc, _zAcc;
+    // set during ComputePotential, the passes then fill _potential (sum of m / r, tree order) instead
+    bool _potentialPass;
+    std::vector<double> _potential;
+    // disjoint subtrees handed to the threads
+    std::vector<uint32_t> _tasks;
+
+    int _order;
+    double _theta;
+    size_t _leafSize;
+    // G * gravityScaling, applied to the far field
+    double _farScale;
+
+    // multi-index tables, rebuilt when the order changes
+    int _coefficientCount;
+    std::vector<int> _degree;
+    // index with one less in component _parentAxis, used to build powers and derivatives
+    std::vector<int> _parent, _parentAxis;
+    // indices of n - e_i and n - 2e_i, -1 if that component is too small
+    std::vector<int> _minusOne, _minusTwo;
+    std::vector<Term> _m2m, _m2l, _l2l;
+    // per axis, acceleration terms of the local expansion
+    std::vector<Term> _l2p[3];
+
+    void BuildTables();
+    void Powers(double x, double y, double z, double* powers) const;
+    void Derivatives(double x, double y, double z, double* derivatives) const;
+    void Upward();
+    // splits the tree into _tasks, then interacts and pushes down each of them
+    void Evaluate(const GravityParams& params, ThreadPool& pool);
+    // direct sum from the bodies of source to the bodies of target
+    void Near(const OctreeNode& target, const OctreeNode& source, const GravityParams& params);
+    void Interact(uint32_t targetNode, uint32_t sourceNode, const GravityParams& params);
+    void Downward(uint32_t node);
+public:
+    static constexpr int maxOrder = 8;
+
+    FmmSolver();
+
+    const char* GetName() const override;
+    int ComputeAccelerations(BodyStore& bodies, const GravityParams& params, ThreadPool& pool) override;
+    // the same expansions evaluated for the potential instead of its gradient
+    double ComputePotential(const BodyStore& bodies, const GravityParams& params, ThreadPool& pool) override;
+
+    // expansion order, error falls off roughly as theta^(order + 1)
+    int GetOrder() const;
+    int SetOrder(int order);
+    double GetOpeningAngle() const;
+    int SetOpeningAngle(double theta);
+};
+
+#endif
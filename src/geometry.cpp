@@ -0,0 +1,357 @@
+#include "geometry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "snapshot.hpp"
+#include "values.hpp"
+
+// x86-64 only, ToBytes relies on SSE2 being part of the baseline
+#if defined(__GNUC__) && defined(__x86_64__)
+    #define GEOMETRY_X86
+    #include <immintrin.h>
+#endif
+
+inline double Radians(double degrees) {
+    return degrees * (pi / 180.0);
+}
+
+inline void AddValues(std::vector<float>& vertexData, float f0, float f1, float f2, float f3) {
+    vertexData.push_back(f0);
+    vertexData.push_back(f1);
+    vertexData.push_back(f2);
+    vertexData.push_back(f3);
+}
+
+inline void AddValues(std::vector<unsigned int>& elementData, unsigned int f0, unsigned int f1, unsigned int f2) {
+    elementData.push_back(f0);
+    elementData.push_back(f1);
+    elementData.push_back(f2);
+}
+
+void BuildSphereMesh(int stackCount, int sectorCount, std::vector<float>& vertexData, std::vector<unsigned int>& elementData) {
+    // tracks initial vertexData size to offset indices
+    unsigned int elementStart = vertexData.size() / meshFloatWidth;
+    size_t elementIndexStart = elementData.size();
+
+    const double stackAngle = 180.0 / stackCount;
+    const double sectorAngle = 360.0 / sectorCount;
+
+    // vertexData
+    // top
+    AddValues(vertexData, 0.0f, 0.0f, 1.0f, 1.0f);
+    // all other points
+    for (int i = 1; i < stackCount; i++) {
+        double dzn = cos(Radians(i * stackAngle));
+        for (int j = 0; j < sectorCount; j++) {
+            double dxn = sin(Radians(i * stackAngle)) * cos(Radians(j * sectorAngle));
+            double dyn = sin(Radians(i * stackAngle)) * sin(Radians(j * sectorAngle));
+            AddValues(vertexData, dxn, dyn, dzn, 0.0f);
+        }
+    }
+    // bottom
+    AddValues(vertexData, 0.0f, 0.0f, -1.0f, 1.0f);
+
+    // elementData
+    // top triangles
+    for (int j = 1; j <= sectorCount; j++) {
+        AddValues(elementData, 0, j, (j % sectorCount) + 1);
+    }
+    // middle squares
+    for (int i = 0; i < (stackCount - 1); i++) {
+        if (i > 0) {
+            int rowIndexStart = sectorCount * i;
+            for (int j = 1; j <= sectorCount; j++) {
+                int vertex1 = j + rowIndexStart;
+                int vertex2 = (j % sectorCount) + 1 + rowIndexStart;
+                int vertex3 = (j % sectorCount) + 1 + rowIndexStart - sectorCount;
+                AddValues(elementData, vertex1, vertex2, vertex3);
+            }
+        }
+        if (i < (stackCount - 2)) {
+            int rowIndexStart = sectorCount * i;
+            for (int j = 1; j <= sectorCount; j++) {
+                int vertex1 = j + rowIndexStart;
+                int vertex2 = (j % sectorCount) + 1 + rowIndexStart;
+                int vertex3 = j + sectorCount + rowIndexStart;
+                AddValues(elementData, vertex1, vertex2, vertex3);
+            }
+        }
+    }
+    // bottom triangles
+    int start = (stackCount - 2) * sectorCount + 1;
+    int end = (stackCount - 1) * sectorCount;
+    for (int j = start; j <= end; j++) {
+        AddValues(elementData, end + 1, j, start + (j % sectorCount));
+    }
+    // offset indices by element start value
+    for (size_t i = elementIndexStart; i < elementData.size(); i++) {
+        elementData[i] += elementStart;
+    }
+}
+
+void BuildSphereLods(std::vector<float>& vertexData, std::vector<unsigned int>& elementData, std::vector<SphereLod>& lods) {
+    vertexData.clear();
+    elementData.clear();
+    lods.resize(sphereLodCount);
+    for (int level = 0; level < sphereLodCount; level++) {
+        SphereLod& lod = lods[level];
+        lod.stacks = sphereLodStacks[level];
+        lod.sectors = sphereLodStacks[level];
+        lod.firstElement = elementData.size();
+        BuildSphereMesh(lod.stacks, lod.sectors, vertexData, elementData);
+        lod.elementCount = elementData.size() - lod.firstElement;
+    }
+}
+
+int SelectSphereLod(double radius, double distance, double pixelScale) {
+    // inside the body it is as large as it gets
+    double pixels = distance > radius ? radius / distance * pixelScale : INFINITY;
+    for (int level = 0; level < sphereLodCount; level++) {
+        if (pixels >= sphereLodPixels[level]) {
+            return level;
+        }
+    }
+    return impostorLevel;
+}
+
+inline void Normalize(double v[3]) {
+    double length = sqrt((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]));
+    if (length > 0.0) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+void SetViewFrustum(LodView& view, const double front[3], const double up[3], double fov, double aspect) {
+    double f[3] = { front[0], front[1], front[2] };
+    Normalize(f);
+    // camera basis, right = front x up, up = right x front
+    double r[3] = { (f[1] * up[2]) - (f[2] * up[1]), (f[2] * up[0]) - (f[0] * up[2]), (f[0] * up[1]) - (f[1] * up[0]) };
+    Normalize(r);
+    double u[3] = { (r[1] * f[2]) - (r[2] * f[1]), (r[2] * f[0]) - (r[0] * f[2]), (r[0] * f[1]) - (r[1] * f[0]) };
+    double tanVertical = tan(Radians(fov) / 2.0);
+    double tanHorizontal = tanVertical * aspect;
+    // a point q (relative to the camera) is inside while |q.r| <= (q.f) tanHorizontal and |q.u| <= (q.f) tanVertical
+    for (int k = 0; k < 3; k++) {
+        view.planes[0][k] = f[k];
+        view.planes[1][k] = (f[k] * tanHorizontal) + r[k];
+        view.planes[2][k] = (f[k] * tanHorizontal) - r[k];
+        view.planes[3][k] = (f[k] * tanVertical) + u[k];
+        view.planes[4][k] = (f[k] * tanVertical) - u[k];
+    }
+    for (double* plane: view.planes) {
+        Normalize(plane);
+    }
+    view.planeCount = 5;
+}
+
+typedef size_t (*CullFunction)(const Snapshot&, const double (&)[5][3], double, double, double, uint32_t*);
+
+// whether body i is at least partly in front of all planes
+inline bool InsideFrustum(const Snapshot& bodies, const double (&p)[5][3], size_t i, double cx, double cy, double cz) {
+    double dx = bodies.x[i] - cx;
+    double dy = bodies.y[i] - cy;
+    double dz = bodies.z[i] - cz;
+    double r = -bodies.radius[i];
+    bool inside = true;
+    for (int k = 0; k < 5; k++) {
+        inside &= (p[k][0] * dx) + (p[k][1] * dy) + (p[k][2] * dz) >= r;
+    }
+    return inside;
+}
+
+// writes the index of every body at least partly in front of all planes to visible, returns how many
+// the index is always stored and only the count depends on the test, so there is no branch to mispredict
+static size_t CullScalar(const Snapshot& bodies, const double (&p)[5][3], double cx, double cy, double cz, uint32_t* visible) {
+    size_t count = bodies.Size();
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        visible[n] = i;
+        n += InsideFrustum(bodies, p, i, cx, cy, cz);
+    }
+    return n;
+}
+
+#ifdef GEOMETRY_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+// four bodies per step
+static size_t CullAvx2(const Snapshot& bodies, const double (&p)[5][3], double cx, double cy, double cz, uint32_t* visible) {
+    size_t count = bodies.Size();
+    const __m256d cxv = _mm256_set1_pd(cx), cyv = _mm256_set1_pd(cy), czv = _mm256_set1_pd(cz);
+    __m256d planes[5][3];
+    for (int k = 0; k < 5; k++) {
+        for (int c = 0; c < 3; c++) {
+            planes[k][c] = _mm256_set1_pd(p[k][c]);
+        }
+    }
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(&bodies.x[i]), cxv);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(&bodies.y[i]), cyv);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(&bodies.z[i]), czv);
+        __m256d r = _mm256_sub_pd(_mm256_setzero_pd(), _mm256_loadu_pd(&bodies.radius[i]));
+        __m256d inside = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        for (int k = 0; k < 5; k++) {
+            __m256d distance = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(planes[k][0], dx), _mm256_mul_pd(planes[k][1], dy)),
+                _mm256_mul_pd(planes[k][2], dz));
+            inside = _mm256_and_pd(inside, _mm256_cmp_pd(distance, r, _CMP_GE_OQ));
+        }
+        int mask = _mm256_movemask_pd(inside);
+        visible[n] = i;
+        n += mask & 1;
+        visible[n] = i + 1;
+        n += (mask >> 1) & 1;
+        visible[n] = i + 2;
+        n += (mask >> 2) & 1;
+        visible[n] = i + 3;
+        n += (mask >> 3) & 1;
+    }
+    for (; i < count; i++) {
+        visible[n] = i;
+        n += InsideFrustum(bodies, p, i, cx, cy, cz);
+    }
+    return n;
+}
+
+#pragma GCC pop_options
+
+#endif
+
+static CullFunction BestCull() {
+    #ifdef GEOMETRY_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return CullAvx2;
+        }
+    #endif
+    return CullScalar;
+}
+
+static const CullFunction _cull = BestCull();
+
+void FillSphereInstances(const Snapshot& bodies, const LodView& view, SphereInstances& instances) {
+    size_t count = bodies.Size();
+    instances.indices.resize(count);
+    for (size_t& levelCount: instances.counts) {
+        levelCount = 0;
+    }
+    // unused planes let everything through
+    double planes[5][3] = {};
+    for (int k = 0; k < view.planeCount && k < 5; k++) {
+        planes[k][0] = view.planes[k][0];
+        planes[k][1] = view.planes[k][1];
+        planes[k][2] = view.planes[k][2];
+    }
+    size_t visible = _cull(bodies, planes, view.x, view.y, view.z, instances.indices.data());
+    instances.visible = visible;
+    instances.culled = count - visible;
+
+    instances.levels.resize(visible);
+    for (size_t v = 0; v < visible; v++) {
+        uint32_t i = instances.indices[v];
+        double dx = bodies.x[i] - view.x;
+        double dy = bodies.y[i] - view.y;
+        double dz = bodies.z[i] - view.z;
+        int level = SelectSphereLod(bodies.radius[i], sqrt((dx * dx) + (dy * dy) + (dz * dz)), view.pixelScale);
+        instances.levels[v] = level;
+        instances.counts[level]++;
+    }
+    size_t first = 0;
+    size_t next[sphereLodCount + 1];
+    for (int level = 0; level <= sphereLodCount; level++) {
+        instances.first[level] = first;
+        next[level] = first;
+        first += instances.counts[level];
+    }
+
+    instances.data.resize(visible * instanceFloatWidth);
+    for (size_t v = 0; v < visible; v++) {
+        uint32_t i = instances.indices[v];
+        float* instance = instances.data.data() + next[instances.levels[v]]++ * instanceFloatWidth;
+        instance[0] = bodies.x[i];
+        instance[1] = bodies.y[i];
+        instance[2] = bodies.z[i];
+        instance[3] = bodies.radius[i];
+        instance[4] = bodies.red[i];
+        instance[5] = bodies.green[i];
+        instance[6] = bodies.blue[i];
+        instance[7] = bodies.luminosity[i];
+        instance[8] = bodies.theta[i];
+    }
+}
+
+// log2 to within 0.09, the exponent plus the mantissa taken as linear
+inline float FastLog2(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int exponent = (int)((bits >> 52) & 0x7FF) - 1023;
+    // same mantissa with a zero exponent, in [1, 2)
+    bits = (bits & 0xFFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+    double mantissa;
+    memcpy(&mantissa, &bits, sizeof(mantissa));
+    return (float)exponent + (float)(mantissa - 1.0);
+}
+
+// rgba in [0, 1] to normalized bytes, clamped
+inline void ToBytes(float r, float g, float b, float a, unsigned char* bytes) {
+    #ifdef GEOMETRY_X86
+        // all four at once, sse2 is part of every x86-64 cpu
+        __m128 value = _mm_set_ps(a, b, g, r);
+        value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        __m128i rounded = _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(255.0f)));
+        rounded = _mm_packs_epi32(rounded, rounded);
+        rounded = _mm_packus_epi16(rounded, rounded);
+        int packed = _mm_cvtsi128_si32(rounded);
+        memcpy(bytes, &packed, 4);
+    #else
+        const float values[4] = { r, g, b, a };
+        for (int i = 0; i < 4; i++) {
+            float value = std::min(std::max(values[i], 0.0f), 1.0f);
+            bytes[i] = (unsigned char)(value * 255.0f + 0.5f);
+        }
+    #endif
+}
+
+void FillPointCloud(const Snapshot& bodies, CloudScale& scale, CloudPoint* points) {
+    size_t count = bodies.Size();
+    // local pointers, the byte stores below would otherwise make the compiler reload the vectors every body
+    const double* x = bodies.x.data();
+    const double* y = bodies.y.data();
+    const double* z = bodies.z.data();
+    const double* mass = bodies.mass.data();
+    const float* red = bodies.red.data();
+    const float* green = bodies.green.data();
+    const float* blue = bodies.blue.data();
+    const float* luminosity = bodies.luminosity.data();
+    float range = scale.maxLogMass - scale.minLogMass;
+    float weightScale = range > 0.0f ? 1.0f / range : 0.0f;
+    float minLogMass = INFINITY;
+    float maxLogMass = -INFINITY;
+    for (size_t i = 0; i < count; i++) {
+        CloudPoint& point = points[i];
+        point.x = x[i];
+        point.y = y[i];
+        point.z = z[i];
+        float weight = 0.0f;
+        if (mass[i] > 0.0) {
+            float logMass = FastLog2(mass[i]);
+            minLogMass = std::min(minLogMass, logMass);
+            maxLogMass = std::max(maxLogMass, logMass);
+            weight = (logMass - scale.minLogMass) * weightScale;
+        }
+        ToBytes(red[i], green[i], blue[i], std::max(weight, luminosity[i]), point.color);
+    }
+    if (minLogMass <= maxLogMass) {
+        scale.minLogMass = minLogMass;
+        scale.maxLogMass = maxLogMass;
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef _GEOMETRY_HPP
+#define _GEOMETRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "snapshot.hpp"
+
+// sphere meshes from fine to coarse, picked by the radius a body covers on screen
+constexpr int sphereLodCount = 4;
+constexpr int sphereLodStacks[sphereLodCount] = { 45, 24, 12, 6 };
+// projected radius (px) from which each level is used, smaller bodies are drawn as point impostors
+constexpr double sphereLodPixels[sphereLodCount] = { 48.0, 12.0, 3.0, 1.0 };
+// instance group of the impostors, after the mesh levels
+constexpr int impostorLevel = sphereLodCount;
+
+// unit sphere vertex: POS.X, POS.Y, POS.Z (also the normal), INVERT (1 at the poles, which show the inverted color)
+constexpr int meshFloatWidth = 4;
+// per body: POS.X, POS.Y, POS.Z, RADIUS, COLOR.R, COLOR.G, COLOR.B, LUMINOSITY, THETA (spin, degrees)
+constexpr int instanceFloatWidth = 9;
+
+// elements of one level inside the shared element buffer
+struct SphereLod {
+    int stacks = 0;
+    int sectors = 0;
+    size_t firstElement = 0;
+    size_t elementCount = 0;
+};
+
+// where the bodies are seen from
+struct LodView {
+    // m
+    double x = 0.0, y = 0.0, z = 0.0;
+    // px per unit of radius / distance, (vertical resolution / 2) / tan(vertical fov / 2)
+    double pixelScale = 1.0;
+    // inward unit normals of the frustum planes through the camera (behind, left, right, bottom, top)
+    // bodies completely behind one of them are culled, nothing is while planeCount is 0
+    int planeCount = 0;
+    double planes[5][3] = {};
+};
+
+// sets the frustum of a camera looking along front, fov is vertical (degrees), aspect is width / height
+// there is no far plane, the depth buffer is logarithmic
+void SetViewFrustum(LodView& view, const double front[3], const double up[3], double fov, double aspect);
+
+// instance data sorted by level, reused between frames
+struct SphereInstances {
+    std::vector<float> data;
+    // instances in each level and the index of its first one, impostors last
+    size_t counts[sphereLodCount + 1] = {};
+    size_t first[sphereLodCount + 1] = {};
+    size_t visible = 0;
+    size_t culled = 0;
+    // scratch, store index and level of each visible body
+    std::vector<uint32_t> indices;
+    std::vector<unsigned char> levels;
+};
+
+// one body of the point cloud render mode, 16 bytes
+struct CloudPoint {
+    // m
+    float x, y, z;
+    // COLOR.R, COLOR.G, COLOR.B, WEIGHT (size and brightness), read as normalized bytes
+    unsigned char color[4];
+};
+
+// log2 mass range the weights are spread over, taken from the previous fill so each frame is one pass
+struct CloudScale {
+    float minLogMass = 0.0f;
+    float maxLogMass = 0.0f;
+};
+
+// appends the triangles of a unit uv sphere, indices continue after the existing vertices
+void BuildSphereMesh(int stackCount, int sectorCount, std::vector<float>& vertexData, std::vector<unsigned int>& elementData);
+// builds every level into one vertex and element buffer, once at setup
+void BuildSphereLods(std::vector<float>& vertexData, std::vector<unsigned int>& elementData, std::vector<SphereLod>& lods);
+
+// level for a body of radius at distance, impostorLevel below the last threshold
+int SelectSphereLod(double radius, double distance, double pixelScale);
+
+// refills instances with one instance per visible body, grouped by level
+// no gl calls, so it can run (and be measured) without a context
+void FillSphereInstances(const Snapshot& bodies, const LodView& view, SphereInstances& instances);
+
+// writes one point per body to points (room for bodies.Size()) and updates scale to their masses
+// weight grows with log mass, luminous bodies get at least their luminosity, massless ones only that
+void FillPointCloud(const Snapshot& bodies, CloudScale& scale, CloudPoint* points);
+
+#endif
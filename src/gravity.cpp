@@ -0,0 +1,395 @@
+#include "gravity.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <string>
+
+#include "definitions.hpp"
+#include "values.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define GRAVITY_X86
+    #include <immintrin.h>
+#endif
+
+// bodies closer than this do not interact (distance > 1e-18)
+constexpr double minDistanceSquared = 1e-36;
+
+// below this, 1 / sqrt(1 - x) is replaced by its series 1 + x/2 + 3x^2/8 + 5x^3/16 (error < 3e-13)
+constexpr double relativitySeriesLimit = 1e-3;
+
+typedef void (*AccumulateFunction)(const GravitySources&, size_t, size_t, double, double, double, double, double, double&, double&, double&);
+typedef void (*PairFunction)(const GravitySources&, size_t, size_t, size_t, double, double, double*, double*, double*);
+
+struct Kernel {
+    const char* name;
+    AccumulateFunction accumulate;
+    PairFunction pairs;
+};
+
+inline double RelativityFactor(double x) {
+    if (fabs(x) < relativitySeriesLimit) {
+        return 1.0 + x * (0.5 + x * (0.375 + x * 0.3125));
+    }
+    return 1.0 / sqrt(1.0 - x);
+}
+
+// Gg = G * gravityScaling, k = 2G / (c * cScaling)^2
+static void AccumulateScalar(const GravitySources& s, size_t begin, size_t end,
+    double x, double y, double z, double Gg, double k,
+    double& xAcc, double& yAcc, double& zAcc) {
+    double ax = 0.0, ay = 0.0, az = 0.0;
+    for (size_t j = begin; j < end; j++) {
+        double dx = s.x[j] - x;
+        double dy = s.y[j] - y;
+        double dz = s.z[j] - z;
+        double distanceSquared = (dx * dx) + (dy * dy) + (dz * dz);
+        if (distanceSquared <= minDistanceSquared) {
+            continue;
+        }
+        double inverseDistance = 1.0 / sqrt(distanceSquared);
+        double relativity = 1.0 / sqrt(1.0 - (k * s.mass[j] * inverseDistance));
+        // G * m / d^2 * relativity, projected on (dx, dy, dz) / d
+        double factor = Gg * s.mass[j] * relativity * inverseDistance * inverseDistance * inverseDistance;
+        ax += factor * dx;
+        ay += factor * dy;
+        az += factor * dz;
+    }
+    xAcc += ax;
+    yAcc += ay;
+    zAcc += az;
+}
+
+// adds the mutual pull of body i and every body of [begin, end)
+static void PairsScalar(const GravitySources& s, size_t i, size_t begin, size_t end,
+    double Gg, double k, double* xAcc, double* yAcc, double* zAcc) {
+    const double x = s.x[i], y = s.y[i], z = s.z[i], mass = s.mass[i];
+    double ax = 0.0, ay = 0.0, az = 0.0;
+    for (size_t j = begin; j < end; j++) {
+        double dx = s.x[j] - x;
+        double dy = s.y[j] - y;
+        double dz = s.z[j] - z;
+        double distanceSquared = (dx * dx) + (dy * dy) + (dz * dz);
+        if (distanceSquared <= minDistanceSquared) {
+            continue;
+        }
+        double inverseDistance = 1.0 / sqrt(distanceSquared);
+        double shared = Gg * inverseDistance * inverseDistance * inverseDistance;
+        // the relativity factor depends on the mass pulling, so it differs per direction
+        double towardJ = s.mass[j] * RelativityFactor(k * s.mass[j] * inverseDistance) * shared;
+        double towardI = mass * RelativityFactor(k * mass * inverseDistance) * shared;
+        ax += towardJ * dx;
+        ay += towardJ * dy;
+        az += towardJ * dz;
+        xAcc[j] -= towardI * dx;
+        yAcc[j] -= towardI * dy;
+        zAcc[j] -= towardI * dz;
+    }
+    xAcc[i] += ax;
+    yAcc[i] += ay;
+    zAcc[i] += az;
+}
+
+#ifdef GRAVITY_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+// float rsqrt estimate (~12 bits), refined by newton steps to double precision
+// callers keep the input inside float range
+static inline __m256d RsqrtAvx2(__m256d v) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d threeHalves = _mm256_set1_pd(1.5);
+    __m256d y = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(v)));
+    __m256d halfV = _mm256_mul_pd(v, half);
+    for (int i = 0; i < 3; i++) {
+        y = _mm256_mul_pd(y, _mm256_fnmadd_pd(halfV, _mm256_mul_pd(y, y), threeHalves));
+    }
+    return y;
+}
+
+static inline __m256d RsqrtExactAvx2(__m256d v) {
+    return _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(v));
+}
+
+static inline bool OutsideFloatRangeAvx2(__m256d v) {
+    __m256d low = _mm256_cmp_pd(v, _mm256_set1_pd(1e-30), _CMP_LT_OQ);
+    __m256d high = _mm256_cmp_pd(v, _mm256_set1_pd(1e30), _CMP_GT_OQ);
+    return _mm256_movemask_pd(_mm256_or_pd(low, high)) != 0;
+}
+
+static inline double HorizontalSumAvx2(__m256d v) {
+    __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+static void AccumulateAvx2(const GravitySources& s, size_t begin, size_t end,
+    double x, double y, double z, double Gg, double k,
+    double& xAcc, double& yAcc, double& zAcc) {
+    const __m256d px = _mm256_set1_pd(x);
+    const __m256d py = _mm256_set1_pd(y);
+    const __m256d pz = _mm256_set1_pd(z);
+    const __m256d vGg = _mm256_set1_pd(Gg);
+    const __m256d vk = _mm256_set1_pd(k);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d minD2 = _mm256_set1_pd(minDistanceSquared);
+    __m256d ax = _mm256_setzero_pd(), ay = _mm256_setzero_pd(), az = _mm256_setzero_pd();
+
+    size_t j = begin;
+    for (; j + 4 <= end; j += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(s.x + j), px);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(s.y + j), py);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(s.z + j), pz);
+        __m256d mass = _mm256_loadu_pd(s.mass + j);
+        __m256d d2 = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+        // lanes that are too close (or the target itself) get d2 = 1 and contribute zero
+        __m256d valid = _mm256_cmp_pd(d2, minD2, _CMP_GT_OQ);
+        d2 = _mm256_blendv_pd(one, d2, valid);
+        mass = _mm256_and_pd(mass, valid);
+
+        __m256d inverseDistance = OutsideFloatRangeAvx2(d2) ? RsqrtExactAvx2(d2) : RsqrtAvx2(d2);
+        __m256d t = _mm256_fnmadd_pd(_mm256_mul_pd(vk, mass), inverseDistance, one);
+        __m256d relativity = OutsideFloatRangeAvx2(t) ? RsqrtExactAvx2(t) : RsqrtAvx2(t);
+        __m256d inverseDistance3 = _mm256_mul_pd(inverseDistance, _mm256_mul_pd(inverseDistance, inverseDistance));
+        __m256d factor = _mm256_mul_pd(_mm256_mul_pd(vGg, mass), _mm256_mul_pd(relativity, inverseDistance3));
+        ax = _mm256_fmadd_pd(factor, dx, ax);
+        ay = _mm256_fmadd_pd(factor, dy, ay);
+        az = _mm256_fmadd_pd(factor, dz, az);
+    }
+    xAcc += HorizontalSumAvx2(ax);
+    yAcc += HorizontalSumAvx2(ay);
+    zAcc += HorizontalSumAvx2(az);
+    AccumulateScalar(s, j, end, x, y, z, Gg, k, xAcc, yAcc, zAcc);
+}
+
+// series where every lane is in the weak field, exact otherwise
+static inline __m256d RelativityAvx2(__m256d x) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256d magnitude = _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+    if (_mm256_movemask_pd(_mm256_cmp_pd(magnitude, _mm256_set1_pd(relativitySeriesLimit), _CMP_NLT_UQ)) == 0) {
+        __m256d series = _mm256_fmadd_pd(x, _mm256_set1_pd(0.3125), _mm256_set1_pd(0.375));
+        series = _mm256_fmadd_pd(x, series, _mm256_set1_pd(0.5));
+        return _mm256_fmadd_pd(x, series, one);
+    }
+    return RsqrtExactAvx2(_mm256_sub_pd(one, x));
+}
+
+static void PairsAvx2(const GravitySources& s, size_t i, size_t begin, size_t end,
+    double Gg, double k, double* xAcc, double* yAcc, double* zAcc) {
+    const __m256d px = _mm256_set1_pd(s.x[i]);
+    const __m256d py = _mm256_set1_pd(s.y[i]);
+    const __m256d pz = _mm256_set1_pd(s.z[i]);
+    const __m256d pMass = _mm256_set1_pd(s.mass[i]);
+    const __m256d vGg = _mm256_set1_pd(Gg);
+    const __m256d vk = _mm256_set1_pd(k);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d minD2 = _mm256_set1_pd(minDistanceSquared);
+    __m256d ax = _mm256_setzero_pd(), ay = _mm256_setzero_pd(), az = _mm256_setzero_pd();
+
+    size_t j = begin;
+    for (; j + 4 <= end; j += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(s.x + j), px);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(s.y + j), py);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(s.z + j), pz);
+        __m256d mass = _mm256_loadu_pd(s.mass + j);
+        __m256d d2 = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+        __m256d valid = _mm256_cmp_pd(d2, minD2, _CMP_GT_OQ);
+        d2 = _mm256_blendv_pd(one, d2, valid);
+
+        __m256d inverseDistance = OutsideFloatRangeAvx2(d2) ? RsqrtExactAvx2(d2) : RsqrtAvx2(d2);
+        __m256d shared = _mm256_mul_pd(vGg, _mm256_mul_pd(inverseDistance, _mm256_mul_pd(inverseDistance, inverseDistance)));
+        // invalid lanes contribute nothing in either direction
+        shared = _mm256_and_pd(shared, valid);
+        __m256d kOverD = _mm256_mul_pd(vk, inverseDistance);
+        __m256d towardJ = _mm256_mul_pd(_mm256_mul_pd(mass, RelativityAvx2(_mm256_mul_pd(kOverD, mass))), shared);
+        __m256d towardI = _mm256_mul_pd(_mm256_mul_pd(pMass, RelativityAvx2(_mm256_mul_pd(kOverD, pMass))), shared);
+        ax = _mm256_fmadd_pd(towardJ, dx, ax);
+        ay = _mm256_fmadd_pd(towardJ, dy, ay);
+        az = _mm256_fmadd_pd(towardJ, dz, az);
+        _mm256_storeu_pd(xAcc + j, _mm256_fnmadd_pd(towardI, dx, _mm256_loadu_pd(xAcc + j)));
+        _mm256_storeu_pd(yAcc + j, _mm256_fnmadd_pd(towardI, dy, _mm256_loadu_pd(yAcc + j)));
+        _mm256_storeu_pd(zAcc + j, _mm256_fnmadd_pd(towardI, dz, _mm256_loadu_pd(zAcc + j)));
+    }
+    xAcc[i] += HorizontalSumAvx2(ax);
+    yAcc[i] += HorizontalSumAvx2(ay);
+    zAcc[i] += HorizontalSumAvx2(az);
+    PairsScalar(s, i, j, end, Gg, k, xAcc, yAcc, zAcc);
+}
+
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+
+// rsqrt14 covers the full double range, two newton steps reach double precision
+static inline __m512d RsqrtAvx512(__m512d v) {
+    const __m512d threeHalves = _mm512_set1_pd(1.5);
+    __m512d y = _mm512_rsqrt14_pd(v);
+    __m512d halfV = _mm512_mul_pd(v, _mm512_set1_pd(0.5));
+    for (int i = 0; i < 2; i++) {
+        y = _mm512_mul_pd(y, _mm512_fnmadd_pd(halfV, _mm512_mul_pd(y, y), threeHalves));
+    }
+    return y;
+}
+
+static void AccumulateAvx512(const GravitySources& s, size_t begin, size_t end,
+    double x, double y, double z, double Gg, double k,
+    double& xAcc, double& yAcc, double& zAcc) {
+    const __m512d px = _mm512_set1_pd(x);
+    const __m512d py = _mm512_set1_pd(y);
+    const __m512d pz = _mm512_set1_pd(z);
+    const __m512d vGg = _mm512_set1_pd(Gg);
+    const __m512d vk = _mm512_set1_pd(k);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d minD2 = _mm512_set1_pd(minDistanceSquared);
+    __m512d ax = _mm512_setzero_pd(), ay = _mm512_setzero_pd(), az = _mm512_setzero_pd();
+
+    for (size_t j = begin; j < end; j += 8) {
+        // the tail is handled by masked loads, missing lanes load as zero mass
+        __mmask8 lanes = (end - j >= 8) ? 0xFF : (__mmask8)((1u << (end - j)) - 1);
+        __m512d dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.x + j), px);
+        __m512d dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.y + j), py);
+        __m512d dz = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.z + j), pz);
+        __m512d d2 = _mm512_fmadd_pd(dz, dz, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx)));
+        __mmask8 valid = _mm512_mask_cmp_pd_mask(lanes, d2, minD2, _CMP_GT_OQ);
+        __m512d mass = _mm512_maskz_loadu_pd(valid, s.mass + j);
+        d2 = _mm512_mask_blend_pd(valid, one, d2);
+
+        __m512d inverseDistance = RsqrtAvx512(d2);
+        __m512d t = _mm512_fnmadd_pd(_mm512_mul_pd(vk, mass), inverseDistance, one);
+        __m512d relativity = RsqrtAvx512(t);
+        __m512d inverseDistance3 = _mm512_mul_pd(inverseDistance, _mm512_mul_pd(inverseDistance, inverseDistance));
+        __m512d factor = _mm512_mul_pd(_mm512_mul_pd(vGg, mass), _mm512_mul_pd(relativity, inverseDistance3));
+        ax = _mm512_fmadd_pd(factor, dx, ax);
+        ay = _mm512_fmadd_pd(factor, dy, ay);
+        az = _mm512_fmadd_pd(factor, dz, az);
+    }
+    xAcc += _mm512_reduce_add_pd(ax);
+    yAcc += _mm512_reduce_add_pd(ay);
+    zAcc += _mm512_reduce_add_pd(az);
+}
+
+static inline __m512d RelativityAvx512(__m512d x) {
+    const __m512d one = _mm512_set1_pd(1.0);
+    __m512d magnitude = _mm512_abs_pd(x);
+    if (_mm512_cmp_pd_mask(magnitude, _mm512_set1_pd(relativitySeriesLimit), _CMP_NLT_UQ) == 0) {
+        __m512d series = _mm512_fmadd_pd(x, _mm512_set1_pd(0.3125), _mm512_set1_pd(0.375));
+        series = _mm512_fmadd_pd(x, series, _mm512_set1_pd(0.5));
+        return _mm512_fmadd_pd(x, series, one);
+    }
+    return _mm512_div_pd(one, _mm512_sqrt_pd(_mm512_sub_pd(one, x)));
+}
+
+static void PairsAvx512(const GravitySources& s, size_t i, size_t begin, size_t end,
+    double Gg, double k, double* xAcc, double* yAcc, double* zAcc) {
+    const __m512d px = _mm512_set1_pd(s.x[i]);
+    const __m512d py = _mm512_set1_pd(s.y[i]);
+    const __m512d pz = _mm512_set1_pd(s.z[i]);
+    const __m512d pMass = _mm512_set1_pd(s.mass[i]);
+    const __m512d vGg = _mm512_set1_pd(Gg);
+    const __m512d vk = _mm512_set1_pd(k);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d minD2 = _mm512_set1_pd(minDistanceSquared);
+    __m512d ax = _mm512_setzero_pd(), ay = _mm512_setzero_pd(), az = _mm512_setzero_pd();
+
+    for (size_t j = begin; j < end; j += 8) {
+        __mmask8 lanes = (end - j >= 8) ? 0xFF : (__mmask8)((1u << (end - j)) - 1);
+        __m512d dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.x + j), px);
+        __m512d dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.y + j), py);
+        __m512d dz = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.z + j), pz);
+        __m512d mass = _mm512_maskz_loadu_pd(lanes, s.mass + j);
+        __m512d d2 = _mm512_fmadd_pd(dz, dz, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx)));
+        __mmask8 valid = _mm512_mask_cmp_pd_mask(lanes, d2, minD2, _CMP_GT_OQ);
+        d2 = _mm512_mask_blend_pd(valid, one, d2);
+
+        __m512d inverseDistance = RsqrtAvx512(d2);
+        __m512d shared = _mm512_maskz_mul_pd(valid, vGg, _mm512_mul_pd(inverseDistance, _mm512_mul_pd(inverseDistance, inverseDistance)));
+        __m512d kOverD = _mm512_mul_pd(vk, inverseDistance);
+        __m512d towardJ = _mm512_mul_pd(_mm512_mul_pd(mass, RelativityAvx512(_mm512_mul_pd(kOverD, mass))), shared);
+        __m512d towardI = _mm512_mul_pd(_mm512_mul_pd(pMass, RelativityAvx512(_mm512_mul_pd(kOverD, pMass))), shared);
+        ax = _mm512_fmadd_pd(towardJ, dx, ax);
+        ay = _mm512_fmadd_pd(towardJ, dy, ay);
+        az = _mm512_fmadd_pd(towardJ, dz, az);
+        _mm512_mask_storeu_pd(xAcc + j, lanes, _mm512_fnmadd_pd(towardI, dx, _mm512_maskz_loadu_pd(lanes, xAcc + j)));
+        _mm512_mask_storeu_pd(yAcc + j, lanes, _mm512_fnmadd_pd(towardI, dy, _mm512_maskz_loadu_pd(lanes, yAcc + j)));
+        _mm512_mask_storeu_pd(zAcc + j, lanes, _mm512_fnmadd_pd(towardI, dz, _mm512_maskz_loadu_pd(lanes, zAcc + j)));
+    }
+    xAcc[i] += _mm512_reduce_add_pd(ax);
+    yAcc[i] += _mm512_reduce_add_pd(ay);
+    zAcc[i] += _mm512_reduce_add_pd(az);
+}
+
+#pragma GCC pop_options
+
+#endif
+
+static bool KernelSupported(const std::string& name) {
+    if (name == "scalar") {
+        return true;
+    }
+    #ifdef GRAVITY_X86
+        __builtin_cpu_init();
+        if (name == "avx2") {
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        }
+        if (name == "avx512") {
+            return __builtin_cpu_supports("avx512f");
+        }
+    #endif
+    return false;
+}
+
+static const Kernel _kernels[] = {
+    #ifdef GRAVITY_X86
+        { "avx512", AccumulateAvx512, PairsAvx512 },
+        { "avx2", AccumulateAvx2, PairsAvx2 },
+    #endif
+    { "scalar", AccumulateScalar, PairsScalar },
+};
+
+// first supported entry, the table is ordered fastest first
+static const Kernel* BestKernel() {
+    for (const Kernel& kernel: _kernels) {
+        if (KernelSupported(kernel.name)) {
+            return &kernel;
+        }
+    }
+    return nullptr;
+}
+
+static std::atomic<const Kernel*> _kernel(BestKernel());
+
+
+// public
+
+void AccumulateAcceleration(const GravitySources& sources, size_t begin, size_t end,
+    double x, double y, double z, const GravityParams& params,
+    double& xAcc, double& yAcc, double& zAcc) {
+    double Gg = G * params.gravityScaling;
+    double k = G2oc2 / (params.cScaling * params.cScaling);
+    _kernel.load(std::memory_order_relaxed)->accumulate(sources, begin, end, x, y, z, Gg, k, xAcc, yAcc, zAcc);
+}
+
+void AccumulatePairAccelerations(const GravitySources& sources, size_t i, size_t begin, size_t end,
+    const GravityParams& params, double* xAcc, double* yAcc, double* zAcc) {
+    double Gg = G * params.gravityScaling;
+    double k = G2oc2 / (params.cScaling * params.cScaling);
+    _kernel.load(std::memory_order_relaxed)->pairs(sources, i, begin, end, Gg, k, xAcc, yAcc, zAcc);
+}
+
+const char* GetGravityKernel() {
+    return _kernel.load()->name;
+}
+
+int SetGravityKernel(const std::string& name) {
+    if (!KernelSupported(name)) {
+        return FAIL;
+    }
+    for (const Kernel& kernel: _kernels) {
+        if (name == kernel.name) {
+            _kernel = &kernel;
+            return SUCCESS;
+        }
+    }
+    return FAIL;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef _GRAVITY_HPP
+#define _GRAVITY_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+#include "values.hpp"
+
+// read-only view of the bodies that pull on a target
+struct GravitySources {
+    const double* x = nullptr;
+    const double* y = nullptr;
+    const double* z = nullptr;
+    const double* mass = nullptr;
+    size_t count = 0;
+};
+
+struct GravityParams {
+    double gravityScaling = 1.0;
+    double cScaling = 1.0; // scaling speed of causality
+};
+
+inline double CalculateGravitationalAcceleration(double mass, double distanceSquared, double cScaling) {
+    double distance = sqrt(distanceSquared);
+    double G2oc2Scaled = G2oc2 / (cScaling * cScaling); // 1 / c^2 -> 1 / cScaling^2
+    double relativity = 1.0 / sqrt(1.0 - (G2oc2Scaled * mass / distance));
+    return (G * mass / distanceSquared) * relativity;
+    // https://physics.stackexchange.com/questions/47379/what-is-the-weight-equation-through-general-relativity
+}
+
+// adds the acceleration (m/s^2) at point (x, y, z) caused by sources [begin, end) to xAcc, yAcc, zAcc
+// sources closer than 1e-18 m (including the target itself) are ignored
+void AccumulateAcceleration(const GravitySources& sources, size_t begin, size_t end,
+    double x, double y, double z, const GravityParams& params,
+    double& xAcc, double& yAcc, double& zAcc);
+
+// adds the mutual accelerations of body i and every body of [begin, end) to both sides,
+// so each unordered pair is only evaluated once (callers keep i outside [begin, end))
+void AccumulatePairAccelerations(const GravitySources& sources, size_t i, size_t begin, size_t end,
+    const GravityParams& params, double* xAcc, double* yAcc, double* zAcc);
+
+// kernel selection, picked from the cpu at startup: "avx512", "avx2" or "scalar"
+const char* GetGravityKernel();
+// fails if the kernel is unknown or unsupported by this cpu
+int SetGravityKernel(const std::string& name);
+
+#endif
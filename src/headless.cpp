@@ -0,0 +1,86 @@
+#include "headless.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "definitions.hpp"
+#include "profiler.hpp"
+#include "universe.hpp"
+
+// used when neither --ticks nor --duration is given
+constexpr long long defaultTicks = 1000;
+
+int RunHeadless(Universe& universe, const CommandLineOptions& options) {
+    double tickDuration = universe.GetTimeScaling() / universe.GetTickSpeed();
+    long long ticks = defaultTicks;
+    if (options.ticks > 0) {
+        ticks = options.ticks;
+    }
+    else if (options.duration > 0.0) {
+        ticks = (long long)ceil(options.duration / tickDuration);
+    }
+    std::cout << "headless: " << ticks << " ticks of " << tickDuration << " s, solver " << universe.GetSolver()
+        << ", integrator " << universe.GetIntegrator() << ", " << universe.GetThreadCount() << " threads, "
+        << universe.GetBodies().Size() << " bodies\n";
+
+    if (options.record.path != "" && universe.StartRecording(options.record) <= FAIL) {
+        return FAIL;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    double minTick = INFINITY, maxTick = 0.0;
+    Clock::time_point start = Clock::now();
+    Clock::time_point tickStart = start;
+    for (long long tick = 0; tick < ticks; tick++) {
+        if (universe.CalculateTick() <= FAIL) {
+            std::cout << "headless: tick " << tick << " failed\n";
+            return FAIL;
+        }
+        if (options.maxDrift > 0.0) {
+            ConservationStats conservation;
+            universe.GetConservation(conservation);
+            double drift = std::max({ conservation.energyDrift, conservation.momentumDrift, conservation.angularMomentumDrift });
+            if (drift > options.maxDrift) {
+                std::cout << "headless: drift " << drift << " passed " << options.maxDrift << " at tick " << tick
+                    << " (energy " << conservation.energyDrift << ", momentum " << conservation.momentumDrift
+                    << ", angular momentum " << conservation.angularMomentumDrift << ")\n";
+                return FAIL;
+            }
+        }
+        Clock::time_point tickEnd = Clock::now();
+        double seconds = std::chrono::duration<double>(tickEnd - tickStart).count();
+        minTick = std::min(minTick, seconds);
+        maxTick = std::max(maxTick, seconds);
+        tickStart = tickEnd;
+    }
+    double wall = std::chrono::duration<double>(tickStart - start).count();
+    double simulated = ticks * tickDuration;
+
+    std::cout << "headless: done\n"
+        << "  wall time       " << wall << " s\n"
+        << "  simulated time  " << simulated << " s\n"
+        << "  ticks / s       " << ticks / wall << "\n"
+        << "  sim s / wall s  " << simulated / wall << "\n"
+        << "  tick ms         mean " << wall / ticks * 1e3 << ", min " << minTick * 1e3 << ", max " << maxTick * 1e3 << "\n";
+    ConservationStats conservation;
+    universe.GetConservation(conservation);
+    std::cout << "  max drift       energy " << conservation.maxEnergyDrift << ", momentum " << conservation.maxMomentumDrift
+        << ", angular momentum " << conservation.maxAngularMomentumDrift << "\n";
+    int result = SUCCESS;
+    if (options.record.path != "") {
+        // waits for the writer to drain, the totals stay readable afterwards
+        int stopped = universe.StopRecording();
+        RecorderStats recording;
+        universe.GetRecording(recording);
+        double ratio = recording.bytes > 0 ? (double)recording.rawBytes / recording.bytes : 0.0;
+        std::cout << "  recording       " << recording.frames << " frames, " << recording.dropped << " dropped, "
+            << ratio << "x smaller than raw" << (stopped <= FAIL ? ", write failed" : "") << "\n";
+        // the trajectory is incomplete, a batch job must not look successful
+        result = stopped;
+    }
+    PrintProfile(std::cout);
+    return result;
+}
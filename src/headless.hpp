@@ -0,0 +1,12 @@
+#pragma once
+#ifndef _HEADLESS_HPP
+#define _HEADLESS_HPP
+
+#include "options.hpp"
+#include "universe.hpp"
+
+// runs ticks back to back without sleeping (recording if asked), then prints timing and conservation statistics
+// fails if a tick fails or the drift passes maxDrift
+int RunHeadless(Universe& universe, const CommandLineOptions& options);
+
+#endif
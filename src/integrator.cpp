@@ -0,0 +1,318 @@
+#include "integrator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "bodystore.hpp"
+#include "definitions.hpp"
+#include "solver.hpp"
+
+// 1 / (2 - 2^(1/3)), the outer substep weight of the fourth order compositions
+static const double fourthOrderOuter = 1.0 / (2.0 - cbrt(2.0));
+// -2^(1/3) / (2 - 2^(1/3)), the (negative) middle one
+static const double fourthOrderInner = 1.0 - (2.0 * fourthOrderOuter);
+
+// block steps are eta * |a| / |da/dt|, about eta / 2pi of an orbit for circular motion
+constexpr double blockAccuracy = 0.02;
+
+static int ComputeForces(BodyStore& bodies, const ForceContext& forces) {
+    return forces.solver->ComputeAccelerations(bodies, forces.params, *forces.pool);
+}
+
+static void Drift(BodyStore& b, double dt) {
+    size_t count = b.Size();
+    for (size_t i = 0; i < count; i++) {
+        b.x[i] += b.xVel[i] * dt;
+        b.y[i] += b.yVel[i] * dt;
+        b.z[i] += b.zVel[i] * dt;
+    }
+}
+
+static void Kick(BodyStore& b, double dt) {
+    size_t count = b.Size();
+    for (size_t i = 0; i < count; i++) {
+        b.xVel[i] += b.xAcc[i] * dt;
+        b.yVel[i] += b.yAcc[i] * dt;
+        b.zVel[i] += b.zAcc[i] * dt;
+    }
+}
+
+// spin does not depend on forces, so it always advances by the whole tick
+static void Rotate(BodyStore& b, double dt) {
+    size_t count = b.Size();
+    for (size_t i = 0; i < count; i++) {
+        b.theta[i] = fmod(b.theta[i] + b.thetaVel[i] * dt, 360.0);
+        b.phi[i] = fmod(b.phi[i] + b.phiVel[i] * dt, 360.0);
+        b.psi[i] = fmod(b.psi[i] + b.psiVel[i] * dt, 360.0);
+    }
+}
+
+static int KickDriftKick(BodyStore& bodies, double dt, const ForceContext& forces, bool& accelerationsValid) {
+    if (!accelerationsValid) {
+        if (ComputeForces(bodies, forces) <= FAIL) {
+            return FAIL;
+        }
+    }
+    Kick(bodies, dt * 0.5);
+    Drift(bodies, dt);
+    accelerationsValid = ComputeForces(bodies, forces) > FAIL;
+    if (!accelerationsValid) {
+        return FAIL;
+    }
+    Kick(bodies, dt * 0.5);
+    return SUCCESS;
+}
+
+
+// EulerIntegrator
+
+const char* EulerIntegrator::GetName() const {
+    return "euler";
+}
+
+int EulerIntegrator::Step(BodyStore& bodies, double dt, const ForceContext& forces) {
+    Drift(bodies, dt);
+    Rotate(bodies, dt);
+    if (ComputeForces(bodies, forces) <= FAIL) {
+        return FAIL;
+    }
+    Kick(bodies, dt);
+    return SUCCESS;
+}
+
+
+// LeapfrogIntegrator
+
+LeapfrogIntegrator::LeapfrogIntegrator() {
+    _accelerationsValid = false;
+}
+
+const char* LeapfrogIntegrator::GetName() const {
+    return "leapfrog";
+}
+
+int LeapfrogIntegrator::Step(BodyStore& bodies, double dt, const ForceContext& forces) {
+    Rotate(bodies, dt);
+    return KickDriftKick(bodies, dt, forces, _accelerationsValid);
+}
+
+void LeapfrogIntegrator::Reset() {
+    _accelerationsValid = false;
+}
+
+
+// YoshidaIntegrator
+
+YoshidaIntegrator::YoshidaIntegrator() {
+    _accelerationsValid = false;
+}
+
+const char* YoshidaIntegrator::GetName() const {
+    return "yoshida4";
+}
+
+int YoshidaIntegrator::Step(BodyStore& bodies, double dt, const ForceContext& forces) {
+    Rotate(bodies, dt);
+    // touching half kicks of neighbouring substeps share one evaluation through the cache
+    if (KickDriftKick(bodies, dt * fourthOrderOuter, forces, _accelerationsValid) <= FAIL ||
+        KickDriftKick(bodies, dt * fourthOrderInner, forces, _accelerationsValid) <= FAIL ||
+        KickDriftKick(bodies, dt * fourthOrderOuter, forces, _accelerationsValid) <= FAIL) {
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+void YoshidaIntegrator::Reset() {
+    _accelerationsValid = false;
+}
+
+
+// ForestRuthIntegrator
+
+const char* ForestRuthIntegrator::GetName() const {
+    return "forestruth";
+}
+
+int ForestRuthIntegrator::Step(BodyStore& bodies, double dt, const ForceContext& forces) {
+    Rotate(bodies, dt);
+    const double kicks[3] = { fourthOrderOuter, fourthOrderInner, fourthOrderOuter };
+    const double drifts[4] = { fourthOrderOuter * 0.5, (1.0 - fourthOrderOuter) * 0.5, (1.0 - fourthOrderOuter) * 0.5, fourthOrderOuter * 0.5 };
+    for (int stage = 0; stage < 3; stage++) {
+        Drift(bodies, drifts[stage] * dt);
+        if (ComputeForces(bodies, forces) <= FAIL) {
+            return FAIL;
+        }
+        Kick(bodies, kicks[stage] * dt);
+    }
+    Drift(bodies, drifts[3] * dt);
+    return SUCCESS;
+}
+
+
+// BlockIntegrator
+
+BlockIntegrator::BlockIntegrator() {
+    _accelerationsValid = false;
+    _maxLevel = 8;
+    _evaluations = 0;
+}
+
+const char* BlockIntegrator::GetName() const {
+    return "block";
+}
+
+int BlockIntegrator::LevelFor(double dt, double timescale) const {
+    double step = blockAccuracy * timescale;
+    if (!(step < dt)) {
+        // also catches an infinite timescale (no jerk) and nan
+        return 0;
+    }
+    // a zero or subnormal step would overflow the cast below, the finest level is the best there is
+    double levels = step > 0.0 ? ceil(log2(dt / step)) : INFINITY;
+    if (!std::isfinite(levels)) {
+        return _maxLevel;
+    }
+    int level = (int)std::min(levels, (double)_maxLevel);
+    return std::max(level, 0);
+}
+
+int BlockIntegrator::Initialize(BodyStore& b, double dt, const ForceContext& forces) {
+    size_t count = b.Size();
+    if (ComputeForces(b, forces) <= FAIL) {
+        return FAIL;
+    }
+    _lastXAcc = b.xAcc;
+    _lastYAcc = b.yAcc;
+    _lastZAcc = b.zAcc;
+
+    // jerk from a drift of one finest substep, every body moves so it includes the motion of the sources
+    double probe = ldexp(dt, -_maxLevel);
+    _x = b.x;
+    _y = b.y;
+    _z = b.z;
+    Drift(b, probe);
+    int result = ComputeForces(b, forces);
+    b.x.swap(_x);
+    b.y.swap(_y);
+    b.z.swap(_z);
+    if (result <= FAIL) {
+        return FAIL;
+    }
+
+    _level.assign(count, 0);
+    for (size_t i = 0; i < count; i++) {
+        double ax = _lastXAcc[i], ay = _lastYAcc[i], az = _lastZAcc[i];
+        double jx = b.xAcc[i] - ax, jy = b.yAcc[i] - ay, jz = b.zAcc[i] - az;
+        double jerk = sqrt((jx * jx) + (jy * jy) + (jz * jz)) / probe;
+        double acceleration = sqrt((ax * ax) + (ay * ay) + (az * az));
+        _level[i] = LevelFor(dt, acceleration / jerk);
+    }
+    b.xAcc = _lastXAcc;
+    b.yAcc = _lastYAcc;
+    b.zAcc = _lastZAcc;
+    _accelerationsValid = true;
+    return SUCCESS;
+}
+
+int BlockIntegrator::Step(BodyStore& b, double dt, const ForceContext& forces) {
+    size_t count = b.Size();
+    Rotate(b, dt);
+    _evaluations = 0;
+    if (!_accelerationsValid || _level.size() != count) {
+        if (Initialize(b, dt, forces) <= FAIL) {
+            return FAIL;
+        }
+        _evaluations += 2 * count;
+    }
+
+    // time runs in integer units of the finest substep, a body at level l steps span >> l units
+    const uint64_t span = (uint64_t)1 << _maxLevel;
+    const double unit = dt / span;
+
+    // every step starts at the beginning of the tick, opening half kicks with the last accelerations
+    for (size_t i = 0; i < count; i++) {
+        double halfStep = 0.5 * unit * (span >> _level[i]);
+        b.xVel[i] += b.xAcc[i] * halfStep;
+        b.yVel[i] += b.yAcc[i] * halfStep;
+        b.zVel[i] += b.zAcc[i] * halfStep;
+    }
+
+    uint64_t now = 0;
+    while (now < span) {
+        // next end of any step, steps are aligned to multiples of their own length
+        uint64_t next = span;
+        for (size_t i = 0; i < count; i++) {
+            uint64_t length = span >> _level[i];
+            next = std::min(next, (now / length + 1) * length);
+        }
+        Drift(b, (next - now) * unit);
+        now = next;
+
+        _active.clear();
+        for (size_t i = 0; i < count; i++) {
+            if (now % (span >> _level[i]) == 0) {
+                _active.push_back(i);
+            }
+        }
+        if (forces.solver->ComputeActiveAccelerations(b, _active, forces.params, *forces.pool) <= FAIL) {
+            _accelerationsValid = false;
+            return FAIL;
+        }
+        _evaluations += _active.size();
+
+        for (uint32_t i: _active) {
+            double step = unit * (span >> _level[i]);
+            double ax = b.xAcc[i], ay = b.yAcc[i], az = b.zAcc[i];
+            // closing half kick
+            b.xVel[i] += ax * 0.5 * step;
+            b.yVel[i] += ay * 0.5 * step;
+            b.zVel[i] += az * 0.5 * step;
+
+            double jx = ax - _lastXAcc[i], jy = ay - _lastYAcc[i], jz = az - _lastZAcc[i];
+            double jerk = sqrt((jx * jx) + (jy * jy) + (jz * jz)) / step;
+            double acceleration = sqrt((ax * ax) + (ay * ay) + (az * az));
+            _lastXAcc[i] = ax;
+            _lastYAcc[i] = ay;
+            _lastZAcc[i] = az;
+
+            // refining is always aligned, coarsening one level at a time and only on a boundary of the coarser step
+            int level = LevelFor(dt, acceleration / jerk);
+            if (level > _level[i]) {
+                _level[i] = level;
+            }
+            else if (level < _level[i] && now % (span >> (_level[i] - 1)) == 0) {
+                _level[i]--;
+            }
+
+            if (now < span) {
+                // opening half kick of the next step
+                double halfStep = 0.5 * unit * (span >> _level[i]);
+                b.xVel[i] += ax * halfStep;
+                b.yVel[i] += ay * halfStep;
+                b.zVel[i] += az * halfStep;
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+void BlockIntegrator::Reset() {
+    _accelerationsValid = false;
+}
+
+int BlockIntegrator::GetMaxLevel() const {
+    return _maxLevel;
+}
+
+int BlockIntegrator::SetMaxLevel(int maxLevel) {
+    if (maxLevel < 0 || maxLevel > levelLimit) {
+        return FAIL;
+    }
+    _maxLevel = maxLevel;
+    _accelerationsValid = false;
+    return SUCCESS;
+}
+
+size_t BlockIntegrator::GetEvaluations() const {
+    return _evaluations;
+}
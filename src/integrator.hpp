@@ -0,0 +1,109 @@
+#pragma once
+#ifndef _INTEGRATOR_HPP
+#define _INTEGRATOR_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "gravity.hpp"
+#include "solver.hpp"
+#include "threadpool.hpp"
+
+// what an integrator needs to evaluate accelerations
+struct ForceContext {
+    Solver* solver;
+    GravityParams params;
+    ThreadPool* pool;
+};
+
+// advances positions and velocities of a universe by one tick
+// bodies.xAcc, yAcc, zAcc hold the accelerations of the last force evaluation afterwards
+class Integrator {
+public:
+    virtual ~Integrator() {}
+
+    virtual const char* GetName() const = 0;
+
+    virtual int Step(BodyStore& bodies, double dt, const ForceContext& forces) = 0;
+
+    // drops accelerations cached from the previous step
+    // needed whenever bodies, masses or force parameters change outside of Step
+    virtual void Reset() {}
+};
+
+// first order, drift then kick (the original update)
+class EulerIntegrator : public Integrator {
+public:
+    const char* GetName() const override;
+    int Step(BodyStore& bodies, double dt, const ForceContext& forces) override;
+};
+
+// second order kick-drift-kick, one force evaluation per step
+// the closing kick's accelerations are reused for the next opening kick
+class LeapfrogIntegrator : public Integrator {
+    bool _accelerationsValid;
+public:
+    LeapfrogIntegrator();
+
+    const char* GetName() const override;
+    int Step(BodyStore& bodies, double dt, const ForceContext& forces) override;
+    void Reset() override;
+};
+
+// fourth order, three leapfrog steps of w1, w0, w1 * dt (Yoshida 1990)
+// three force evaluations per step
+class YoshidaIntegrator : public Integrator {
+    bool _accelerationsValid;
+public:
+    YoshidaIntegrator();
+
+    const char* GetName() const override;
+    int Step(BodyStore& bodies, double dt, const ForceContext& forces) override;
+    void Reset() override;
+};
+
+// fourth order, drift-first (position) form of Forest-Ruth 1990
+// three force evaluations per step, nothing cached
+// the last evaluation is at an inner stage, not at the final positions
+class ForestRuthIntegrator : public Integrator {
+public:
+    const char* GetName() const override;
+    int Step(BodyStore& bodies, double dt, const ForceContext& forces) override;
+};
+
+// second order kick-drift-kick with per body power of two steps dt / 2^level
+// levels come from the acceleration / jerk timescale, eta * |a| / |da/dt|
+// only bodies at the end of their step get forces evaluated, every body is drifted
+// all steps end together at the end of the tick
+class BlockIntegrator : public Integrator {
+    std::vector<uint8_t> _level;
+    // accelerations of the previous evaluation, for the jerk
+    std::vector<double> _lastXAcc, _lastYAcc, _lastZAcc;
+    std::vector<double> _x, _y, _z;
+    std::vector<uint32_t> _active;
+
+    bool _accelerationsValid;
+    int _maxLevel;
+    size_t _evaluations;
+
+    // levels of every body from accelerations and a jerk measured over a short drift
+    int Initialize(BodyStore& bodies, double dt, const ForceContext& forces);
+    int LevelFor(double dt, double timescale) const;
+public:
+    static constexpr int levelLimit = 20;
+
+    BlockIntegrator();
+
+    const char* GetName() const override;
+    int Step(BodyStore& bodies, double dt, const ForceContext& forces) override;
+    void Reset() override;
+
+    // deepest level, a tick is split into at most 2^maxLevel substeps
+    int GetMaxLevel() const;
+    int SetMaxLevel(int maxLevel);
+    // body force evaluations of the last step, count * substeps without block steps
+    size_t GetEvaluations() const;
+};
+
+#endif
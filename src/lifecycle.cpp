@@ -0,0 +1,96 @@
+#include "lifecycle.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#ifdef __linux__
+    #include <sys/eventfd.h>
+    #include <unistd.h>
+#endif
+
+#include "definitions.hpp"
+
+
+// public
+
+Lifecycle::Lifecycle() {
+    _running = true;
+    _exitCode = SUCCESS;
+    _generation = 0;
+    _stopFd = -1;
+    #ifdef __linux__
+        _stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    #endif
+}
+
+Lifecycle::~Lifecycle() {
+    #ifdef __linux__
+        if (_stopFd >= 0) {
+            close(_stopFd);
+        }
+    #endif
+}
+
+bool Lifecycle::IsRunning() const {
+    return _running.load(std::memory_order_acquire);
+}
+
+int Lifecycle::GetExitCode() const {
+    return _exitCode.load(std::memory_order_acquire);
+}
+
+uint64_t Lifecycle::GetGeneration() const {
+    return _generation.load(std::memory_order_acquire);
+}
+
+int Lifecycle::GetStopFd() const {
+    return _stopFd;
+}
+
+void Lifecycle::RequestStop(int exitCode, const std::string& source) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (!_running.load(std::memory_order_relaxed)) {
+            return;
+        }
+        _exitCode.store(exitCode, std::memory_order_relaxed);
+        _running.store(false, std::memory_order_release);
+        _generation.fetch_add(1, std::memory_order_acq_rel);
+    }
+    std::cout << source << " called quit\n";
+    _wake.notify_all();
+    #ifdef __linux__
+        if (_stopFd >= 0) {
+            uint64_t one = 1;
+            // a full counter still leaves the descriptor readable
+            (void)!write(_stopFd, &one, sizeof(one));
+        }
+    #endif
+}
+
+void Lifecycle::Notify() {
+    {
+        // the lock orders the bump against a waiter between its check and its sleep
+        std::lock_guard<std::mutex> lock(_mtx);
+        _generation.fetch_add(1, std::memory_order_acq_rel);
+    }
+    _wake.notify_all();
+}
+
+bool Lifecycle::Wait(uint64_t seen) {
+    std::unique_lock<std::mutex> lock(_mtx);
+    _wake.wait(lock, [&] { return !_running.load() || _generation.load() != seen; });
+    return _running.load();
+}
+
+bool Lifecycle::WaitFor(uint64_t seen, double seconds) {
+    std::unique_lock<std::mutex> lock(_mtx);
+    _wake.wait_for(lock, std::chrono::duration<double>(seconds),
+        [&] { return !_running.load() || _generation.load() != seen; });
+    return _running.load();
+}
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef _LIFECYCLE_HPP
+#define _LIFECYCLE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// shared run state of the program threads
+// any thread can stop everyone, idle threads block in Wait instead of polling flags
+class Lifecycle {
+    std::mutex _mtx;
+    std::condition_variable _wake;
+
+    std::atomic<bool> _running;
+    std::atomic<int> _exitCode;
+    // bumped by every Notify, so a wakeup between reading it and Wait is not lost
+    std::atomic<uint64_t> _generation;
+
+    // linux only, becomes readable once a stop is requested, -1 otherwise
+    int _stopFd;
+public:
+    Lifecycle();
+    ~Lifecycle();
+    Lifecycle(const Lifecycle&) = delete;
+    Lifecycle& operator=(const Lifecycle&) = delete;
+
+    bool IsRunning() const;
+    // code of the first stop request, SUCCESS while running
+    int GetExitCode() const;
+    uint64_t GetGeneration() const;
+    // descriptor for poll() that turns readable on stop, -1 where unsupported
+    int GetStopFd() const;
+
+    // stops every thread, only the first request sets the exit code and prints who called quit
+    void RequestStop(int exitCode, const std::string& source);
+    // wakes every waiting thread without stopping them
+    void Notify();
+    // blocks until the generation moves past seen or a stop is requested
+    // returns false once stopping
+    bool Wait(uint64_t seen);
+    // like Wait, gives up after seconds
+    bool WaitFor(uint64_t seen, double seconds);
+};
+
+#endif
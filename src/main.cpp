@@ -1,3 +1,5 @@
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <mutex>
 #include <set>
@@ -8,21 +10,50 @@
 #include "body.hpp"
 #include "console.hpp"
 #include "definitions.hpp"
+#include "headless.hpp"
+#include "lifecycle.hpp"
+#include "options.hpp"
+#include "profiler.hpp"
 #include "time.hpp"
 #include "universe.hpp"
 #include "values.hpp"
 #include "window.hpp"
 
 // handles the physics of all the objects
-void PhysicsThread(int& sigIn, int& sigOut, Universe& universe);
+void PhysicsThread(Lifecycle& lifecycle, Universe& universe);
 // handles drawing of the frames
-void RenderThread(int& sigIn, int& sigOut, Universe& universe, Window& window);
+void RenderThread(Lifecycle& lifecycle, Universe& universe, Window& window);
 
 void SpawnSolarSystemScaled(Universe& universe, double scaleValue, double radiusScale, double sunRadiusScale);
 
 // handles user inputs
 int main(int argc, char* argv[]) {
-    int failVal = 0;
+    CommandLineOptions options;
+    if (ParseCommandLine(argc, argv, options) <= FAIL) {
+        return EXIT_FAILURE;
+    }
+    if (options.headless) {
+        // same scenario as the windowed run, SDL is never initialized
+        Universe universe;
+        universe.SetTickSpeed(100);
+        universe.SetTimeScaling(86400 * 7);
+        universe.SetGravityScaling(1);
+        if (options.replayFile != "") {
+            // decodes instead of simulating, times the playback
+            if (universe.OpenReplay(options.replayFile) <= FAIL) {
+                return EXIT_FAILURE;
+            }
+        }
+        else {
+            SpawnSolarSystemScaled(universe, SCALE, RADIUS_SCALE, 0.1);
+        }
+        int result = RunHeadless(universe, options);
+        if (options.statsFile != "") {
+            DumpProfile(options.statsFile);
+        }
+        return result <= FAIL ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
     std::mutex mtx;
 
     Time time;
@@ -31,19 +62,28 @@ int main(int argc, char* argv[]) {
     Window window;
     window.OpenWindow();
 
-    int physIn = 1, physOut = 1;
-    std::thread physicsThread = std::thread(PhysicsThread, std::ref(physIn), std::ref(physOut), std::ref(universe));
-    int renderIn = 1, renderOut = 1;
-    std::thread renderThread = std::thread(RenderThread, std::ref(renderIn), std::ref(renderOut), std::ref(universe), std::ref(window));
-    int consoleIn = 1, consoleOut = 1;
-    std::thread consoleThread = std::thread(ConsoleThread, std::ref(consoleIn), std::ref(consoleOut), std::ref(universe), std::ref(window));
+    Lifecycle lifecycle;
+    // from here on the physics thread applies every change between ticks
+    // and sleeps while paused until one comes in
+    universe.SetTickSpeed(100);
+    universe.SetWakeHandler([&lifecycle]() { lifecycle.Notify(); });
+    universe.UseCommandQueue();
+
+    std::thread physicsThread = std::thread(PhysicsThread, std::ref(lifecycle), std::ref(universe));
+    std::thread renderThread = std::thread(RenderThread, std::ref(lifecycle), std::ref(universe), std::ref(window));
+    std::thread consoleThread = std::thread(ConsoleThread, std::ref(lifecycle), std::ref(universe), std::ref(window));
     
     window.SetCameraPosition(-100.0, -100.0, 0);
 
     universe.SetTimeScaling(86400 * 7);
     universe.SetGravityScaling(1);
 
-    SpawnSolarSystemScaled(universe, SCALE, RADIUS_SCALE, 0.1);
+    if (options.replayFile == "" || universe.OpenReplay(options.replayFile) <= FAIL) {
+        SpawnSolarSystemScaled(universe, SCALE, RADIUS_SCALE, 0.1);
+    }
+    if (options.record.path != "") {
+        universe.StartRecording(options.record);
+    }
 
     window.SetCameraSpeed(c * SCALE * 1000);
     window.SetCameraRotationSpeed(120.0);
@@ -52,8 +92,7 @@ int main(int argc, char* argv[]) {
     int key;
     std::set<int> keys;
     bool forward = false, back = false, left = false, right = false;
-    bool running = true;
-    while (running) {
+    while (lifecycle.IsRunning()) {
         time.TickStart();
         
         std::vector<SDL_Event> events = window.PollEvent();
@@ -61,12 +100,7 @@ int main(int argc, char* argv[]) {
             switch (event.type) {
                 // Press Window X
                 case SDL_QUIT:
-                    physIn = 0;
-                    renderIn = 0;
-                    consoleIn = 0;
-                    failVal = 0;
-                    running = false;
-                    std::cout << "main called quit\n";
+                    lifecycle.RequestStop(SUCCESS, "main");
                     break;
                 case SDL_KEYDOWN:
                     key = event.key.keysym.sym;
@@ -217,66 +251,50 @@ int main(int argc, char* argv[]) {
         }
         mtx.unlock();
 
-        if (physOut <= SUCCESS) {
-            std::cout << "physics called quit\n";
-            renderIn = physOut;
-            consoleIn = physOut;
-            failVal = physOut;
-            break;
-        }
-        if (renderOut <= SUCCESS) {
-            std::cout << "render called quit\n";
-            physIn = renderOut;
-            consoleIn = renderOut;
-            failVal = renderOut;
-            break;
-        }
-        if (consoleOut <= SUCCESS) {
-            std::cout << "console called quit\n";
-            physIn = consoleOut;
-            renderIn = consoleOut;
-            failVal = consoleOut;
-            break;
-        }
         time.TickEndAndSleep();
     }
     physicsThread.join();
     renderThread.join();
     consoleThread.join();
 
-    return failVal;
+    if (options.statsFile != "") {
+        DumpProfile(options.statsFile);
+    }
+    // FAIL would become exit status 255
+    return lifecycle.GetExitCode() <= FAIL ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 // threads
 
-void PhysicsThread(int& sigIn, int& sigOut, Universe& universe) {
-    int failVal = 0;
-    universe.SetTickSpeed(100);
-    while (true) {
-        universe.time.TickStart();
-        if (!universe.IsPaused()) {
-            universe.CalculateTick();
-        }
-        if (sigIn <= SUCCESS) {
-            break;
+void PhysicsThread(Lifecycle& lifecycle, Universe& universe) {
+    while (lifecycle.IsRunning()) {
+        // read before the pause check, a change or unpause after it still ends the wait
+        uint64_t seen = lifecycle.GetGeneration();
+        if (universe.IsPaused()) {
+            // console changes still apply and reach the render thread
+            universe.ProcessCommands();
+            universe.PublishSnapshot();
+            lifecycle.Wait(seen);
+            // the idle time is not a backlog to catch up on
+            universe.time.Resync();
+            continue;
         }
+        universe.time.TickStart();
+        universe.CalculateTick();
         universe.time.TickEndAndSleep();
     }
 }
 
-void RenderThread(int& sigIn, int& sigOut, Universe& universe, Window& window) {
+void RenderThread(Lifecycle& lifecycle, Universe& universe, Window& window) {
     int failVal = 0;
     if ((failVal = window.SetupOpenGL()) < SUCCESS) {
-        sigOut = failVal;
+        lifecycle.RequestStop(failVal, "render");
         return;
     }
     window.time.SetTickSpeed(60);
-    while (true) {
+    while (lifecycle.IsRunning()) {
         window.time.TickStart();
         window.DrawFrame(universe);
-        if (sigIn <= SUCCESS) {
-            break;
-        }
         window.time.TickEndAndSleep();
     }
 }
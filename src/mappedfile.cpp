@@ -0,0 +1,136 @@
+#include "mappedfile.hpp"
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "definitions.hpp"
+
+
+// public
+
+MappedFile::MappedFile() {
+    _data = nullptr;
+    _size = 0;
+    #ifdef _WIN32
+        _file = INVALID_HANDLE_VALUE;
+        _mapping = nullptr;
+    #else
+        _fd = -1;
+    #endif
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+int MappedFile::Open(const std::string& path) {
+    Close();
+    #ifdef _WIN32
+        _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (_file == INVALID_HANDLE_VALUE) {
+            return FAIL;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0) {
+            Close();
+            return FAIL;
+        }
+        _mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (_mapping == nullptr) {
+            Close();
+            return FAIL;
+        }
+        _data = (const unsigned char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (_data == nullptr) {
+            Close();
+            return FAIL;
+        }
+        _size = (size_t)size.QuadPart;
+    #else
+        _fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (_fd < 0) {
+            return FAIL;
+        }
+        struct stat info;
+        if (fstat(_fd, &info) != 0 || info.st_size == 0) {
+            Close();
+            return FAIL;
+        }
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+        if (data == MAP_FAILED) {
+            Close();
+            return FAIL;
+        }
+        _data = (const unsigned char*)data;
+        _size = info.st_size;
+    #endif
+    return SUCCESS;
+}
+
+void MappedFile::Close() {
+    #ifdef _WIN32
+        if (_data != nullptr) {
+            UnmapViewOfFile(_data);
+        }
+        if (_mapping != nullptr) {
+            CloseHandle(_mapping);
+        }
+        if (_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(_file);
+        }
+        _mapping = nullptr;
+        _file = INVALID_HANDLE_VALUE;
+    #else
+        if (_data != nullptr) {
+            munmap((void*)_data, _size);
+        }
+        if (_fd >= 0) {
+            close(_fd);
+        }
+        _fd = -1;
+    #endif
+    _data = nullptr;
+    _size = 0;
+}
+
+bool MappedFile::IsOpen() const {
+    return _data != nullptr;
+}
+
+const unsigned char* MappedFile::Data() const {
+    return _data;
+}
+
+size_t MappedFile::Size() const {
+    return _size;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t length) const {
+    if (_data == nullptr || offset >= _size) {
+        return;
+    }
+    #ifndef _WIN32
+        // madvise wants a page aligned start
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t start = offset - (offset % page);
+        size_t end = offset + length < _size ? offset + length : _size;
+        madvise((void*)(_data + start), end - start, MADV_WILLNEED);
+    #endif
+}
+
+void MappedFile::AdviseSequential() const {
+    #ifndef _WIN32
+        if (_data != nullptr) {
+            madvise((void*)_data, _size, MADV_SEQUENTIAL);
+        }
+    #endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+#ifndef _MAPPEDFILE_HPP
+#define _MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// read-only memory map of a whole file, pages are loaded by the os on first touch
+class MappedFile {
+    const unsigned char* _data;
+    size_t _size;
+    #ifdef _WIN32
+        void* _file;
+        void* _mapping;
+    #else
+        int _fd;
+    #endif
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // closes any previous file, fails if path cannot be opened or is empty
+    int Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const;
+    const unsigned char* Data() const;
+    size_t Size() const;
+
+    // hints that [offset, offset + length) is read soon, or read front to back
+    void Prefetch(size_t offset, size_t length) const;
+    void AdviseSequential() const;
+};
+
+#endif
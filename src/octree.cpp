@@ -0,0 +1,151 @@
+#include "octree.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "bodystore.hpp"
+
+// private
+
+void Octree::Split(uint32_t nodeIndex, size_t leafSize) {
+    const OctreeNode node = nodes[nodeIndex];
+    uint32_t count = node.bodyEnd - node.bodyBegin;
+    if (count <= leafSize || node.depth >= maxDepth) {
+        return;
+    }
+
+    // counting sort of the node's bodies by octant
+    uint32_t counts[8] = { 0 };
+    for (uint32_t k = node.bodyBegin; k < node.bodyEnd; k++) {
+        int octant = (x[k] >= node.x) | ((y[k] >= node.y) << 1) | ((z[k] >= node.z) << 2);
+        _scratch[k] = octant;
+        counts[octant]++;
+    }
+    uint32_t offsets[8];
+    uint32_t offset = node.bodyBegin;
+    for (int octant = 0; octant < 8; octant++) {
+        offsets[octant] = offset;
+        offset += counts[octant];
+    }
+    // scatter into the upper half of the scratch buffer, then copy back
+    uint32_t* sorted = _scratch.data() + order.size();
+    for (uint32_t k = node.bodyBegin; k < node.bodyEnd; k++) {
+        sorted[offsets[_scratch[k]]++] = order[k];
+    }
+    for (uint32_t k = node.bodyBegin; k < node.bodyEnd; k++) {
+        order[k] = sorted[k];
+    }
+
+    uint32_t childBegin = nodes.size();
+    uint32_t begin = node.bodyBegin;
+    double quarter = node.halfSize / 2;
+    for (int octant = 0; octant < 8; octant++) {
+        if (counts[octant] == 0) {
+            continue;
+        }
+        OctreeNode child;
+        child.x = node.x + ((octant & 1) ? quarter : -quarter);
+        child.y = node.y + ((octant & 2) ? quarter : -quarter);
+        child.z = node.z + ((octant & 4) ? quarter : -quarter);
+        child.halfSize = quarter;
+        child.bodyBegin = begin;
+        child.bodyEnd = begin + counts[octant];
+        child.depth = node.depth + 1;
+        begin = child.bodyEnd;
+        nodes.push_back(child);
+    }
+    nodes[nodeIndex].childBegin = childBegin;
+    nodes[nodeIndex].childCount = nodes.size() - childBegin;
+}
+
+
+// public
+
+void Octree::Build(const BodyStore& bodies, size_t leafSize) {
+    size_t count = bodies.Size();
+    nodes.clear();
+    order.resize(count);
+    std::iota(order.begin(), order.end(), 0);
+    _scratch.resize(count * 2);
+
+    // working copies, kept in tree order as nodes are split
+    x = bodies.x;
+    y = bodies.y;
+    z = bodies.z;
+
+    OctreeNode root;
+    root.bodyEnd = count;
+    if (count > 0) {
+        double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0], minZ = z[0], maxZ = z[0];
+        for (size_t i = 1; i < count; i++) {
+            minX = std::min(minX, x[i]);
+            maxX = std::max(maxX, x[i]);
+            minY = std::min(minY, y[i]);
+            maxY = std::max(maxY, y[i]);
+            minZ = std::min(minZ, z[i]);
+            maxZ = std::max(maxZ, z[i]);
+        }
+        root.x = (minX + maxX) / 2;
+        root.y = (minY + maxY) / 2;
+        root.z = (minZ + maxZ) / 2;
+        root.halfSize = std::max(std::max(maxX - minX, maxY - minY), maxZ - minZ) / 2;
+        // keep bodies on the max faces inside the cube
+        root.halfSize = root.halfSize > 0 ? root.halfSize * (1 + 1e-9) : 1.0;
+    }
+    nodes.push_back(root);
+
+    // children are appended after their parent, so this visits every node
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        Split(i, leafSize);
+        // Split reorders order[] but not the working positions, gather them for the children
+        const OctreeNode& node = nodes[i];
+        if (node.childCount > 0) {
+            for (uint32_t k = node.bodyBegin; k < node.bodyEnd; k++) {
+                x[k] = bodies.x[order[k]];
+                y[k] = bodies.y[order[k]];
+                z[k] = bodies.z[order[k]];
+            }
+        }
+    }
+
+    mass.resize(count);
+    for (size_t k = 0; k < count; k++) {
+        mass[k] = bodies.mass[order[k]];
+    }
+
+    // masses and centers of mass, children before parents
+    for (size_t i = nodes.size(); i-- > 0;) {
+        OctreeNode& node = nodes[i];
+        double m = 0.0, mx = 0.0, my = 0.0, mz = 0.0;
+        if (node.childCount == 0) {
+            for (uint32_t k = node.bodyBegin; k < node.bodyEnd; k++) {
+                m += mass[k];
+                mx += mass[k] * x[k];
+                my += mass[k] * y[k];
+                mz += mass[k] * z[k];
+            }
+        }
+        else {
+            for (uint32_t c = node.childBegin; c < node.childBegin + node.childCount; c++) {
+                const OctreeNode& child = nodes[c];
+                m += child.mass;
+                mx += child.mass * child.comX;
+                my += child.mass * child.comY;
+                mz += child.mass * child.comZ;
+            }
+        }
+        node.mass = m;
+        if (m != 0.0) {
+            node.comX = mx / m;
+            node.comY = my / m;
+            node.comZ = mz / m;
+        }
+        else {
+            node.comX = node.x;
+            node.comY = node.y;
+            node.comZ = node.z;
+        }
+    }
+}
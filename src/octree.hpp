@@ -0,0 +1,44 @@
+#pragma once
+#ifndef _OCTREE_HPP
+#define _OCTREE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "bodystore.hpp"
+
+struct OctreeNode {
+    // m, cube containing the node
+    double x = 0.0, y = 0.0, z = 0.0;
+    double halfSize = 0.0;
+    // kg, m
+    double mass = 0.0;
+    double comX = 0.0, comY = 0.0, comZ = 0.0;
+    // bodies [bodyBegin, bodyEnd) of the sorted arrays
+    uint32_t bodyBegin = 0, bodyEnd = 0;
+    // non-empty children [childBegin, childBegin + childCount) of nodes, leaf if childCount == 0
+    uint32_t childBegin = 0, childCount = 0;
+    uint32_t depth = 0;
+};
+
+// spatial subdivision of a BodyStore, rebuilt every tick
+// bodies are copied in tree order so every node covers a contiguous range
+class Octree {
+    std::vector<uint32_t> _scratch;
+
+    void Split(uint32_t nodeIndex, size_t leafSize);
+public:
+    static constexpr uint32_t maxDepth = 48;
+
+    // nodes[0] is the root, children always come after their parent
+    std::vector<OctreeNode> nodes;
+    // store index of each sorted body
+    std::vector<uint32_t> order;
+    // bodies sorted in tree order
+    std::vector<double> x, y, z, mass;
+
+    // leaves hold at most leafSize bodies unless maxDepth is reached
+    void Build(const BodyStore& bodies, size_t leafSize);
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "options.hpp"
+
+#include <iostream>
+#include <string>
+
+#include "definitions.hpp"
+#include "recorder.hpp"
+
+int ParseCommandLine(int argc, char* argv[], CommandLineOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            options.headless = true;
+            continue;
+        }
+        if (arg != "--ticks" && arg != "--duration" && arg != "--max-drift" && arg != "--stats"
+            && arg != "--record" && arg != "--record-every" && arg != "--record-fields" && arg != "--replay") {
+            std::cout << "unknown argument: " << arg << "\n";
+            return FAIL;
+        }
+        if (i + 1 >= argc) {
+            std::cout << arg << " needs a value\n";
+            return FAIL;
+        }
+        std::string value = argv[++i];
+        if (arg == "--stats") {
+            options.statsFile = value;
+            continue;
+        }
+        if (arg == "--replay") {
+            options.replayFile = value;
+            continue;
+        }
+        if (arg == "--record") {
+            options.record.path = value;
+            continue;
+        }
+        if (arg == "--record-fields") {
+            if (ParseTrajectoryFields(value, options.record.fields) <= FAIL) {
+                std::cout << "--record-fields must be p, v or pv\n";
+                return FAIL;
+            }
+            continue;
+        }
+        try {
+            if (arg == "--ticks") {
+                options.ticks = std::stoll(value);
+                if (options.ticks <= 0) {
+                    std::cout << "--ticks must be positive\n";
+                    return FAIL;
+                }
+            }
+            else if (arg == "--record-every") {
+                options.record.decimation = std::stoi(value);
+            }
+            else if (arg == "--max-drift") {
+                options.maxDrift = std::stod(value);
+            }
+            else {
+                options.duration = std::stod(value);
+                if (!(options.duration > 0.0)) {
+                    std::cout << "--duration must be positive\n";
+                    return FAIL;
+                }
+            }
+        }
+        catch (...) {
+            std::cout << "invalid value for " << arg << ": " << value << "\n";
+            return FAIL;
+        }
+    }
+    if (options.record.decimation < 1) {
+        std::cout << "--record-every must be positive\n";
+        return FAIL;
+    }
+    return SUCCESS;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#ifndef _OPTIONS_HPP
+#define _OPTIONS_HPP
+
+#include <string>
+
+#include "recorder.hpp"
+
+// everything given on the command line, for both the windowed and the headless run
+struct CommandLineOptions {
+    // batch run without a window, render or console thread
+    bool headless = false;
+    // headless only, stop after this many ticks, or after this many simulated seconds (--ticks wins if both are given)
+    // -1 while not given, given values must be positive
+    long long ticks = -1;
+    double duration = -1.0;
+    // headless only, abort once energy, momentum or angular momentum drifted further than this (relative), off if <= 0
+    double maxDrift = -1.0;
+    // phase timings are written here on exit
+    std::string statsFile;
+    // trajectories go to record.path if it is set
+    RecorderOptions record;
+    // plays this trajectory instead of simulating the solar system
+    std::string replayFile;
+};
+
+// reads --headless, --ticks N, --duration S, --max-drift D, --stats FILE,
+// --record FILE, --record-every K, --record-fields p/v/pv and --replay FILE
+// fails on unknown or malformed arguments
+int ParseCommandLine(int argc, char* argv[], CommandLineOptions& options);
+
+#endif
@@ -0,0 +1,90 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "definitions.hpp"
+
+// samples per phase in the rolling window, a power of two
+constexpr size_t ringSize = 1024;
+
+// fixed ring of the latest samples, writers claim a slot and overwrite it
+// a reader racing a writer may see one sample from the previous lap, which is fine for statistics
+struct PhaseRing {
+    std::atomic<unsigned long long> head{0};
+    std::atomic<float> samples[ringSize];
+};
+
+static PhaseRing _rings[(size_t)Phase::count];
+
+static const char* _phaseNames[(size_t)Phase::count] = {
+    "tick", "commands", "integrate", "collisions", "conservation", "publish", "record", "replay",
+    "frame", "spheres", "upload", "draw"
+};
+
+const char* GetPhaseName(Phase phase) {
+    return _phaseNames[(size_t)phase];
+}
+
+void RecordPhase(Phase phase, double seconds) {
+    PhaseRing& ring = _rings[(size_t)phase];
+    unsigned long long slot = ring.head.fetch_add(1, std::memory_order_acq_rel);
+    ring.samples[slot & (ringSize - 1)].store((float)seconds, std::memory_order_relaxed);
+}
+
+PhaseStats GetPhaseStats(Phase phase) {
+    PhaseRing& ring = _rings[(size_t)phase];
+    PhaseStats stats;
+    stats.total = ring.head.load(std::memory_order_acquire);
+    stats.window = (size_t)std::min<unsigned long long>(stats.total, ringSize);
+    if (stats.window == 0) {
+        return stats;
+    }
+    std::vector<float> samples(stats.window);
+    for (size_t i = 0; i < stats.window; i++) {
+        samples[i] = ring.samples[i].load(std::memory_order_relaxed);
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (float sample: samples) {
+        sum += sample;
+    }
+    stats.mean = sum / stats.window;
+    stats.p50 = samples[(stats.window - 1) / 2];
+    stats.p99 = samples[(stats.window - 1) * 99 / 100];
+    stats.max = samples.back();
+    return stats;
+}
+
+void PrintProfile(std::ostream& out) {
+    out << std::left << std::setw(12) << "phase" << std::right
+        << std::setw(10) << "samples" << std::setw(10) << "mean us" << std::setw(10) << "p50 us"
+        << std::setw(10) << "p99 us" << std::setw(10) << "max us" << "\n";
+    for (size_t p = 0; p < (size_t)Phase::count; p++) {
+        PhaseStats stats = GetPhaseStats((Phase)p);
+        if (stats.total == 0) {
+            continue;
+        }
+        out << std::left << std::setw(12) << GetPhaseName((Phase)p) << std::right
+            << std::setw(10) << stats.total << std::fixed << std::setprecision(1)
+            << std::setw(10) << stats.mean * 1e6 << std::setw(10) << stats.p50 * 1e6
+            << std::setw(10) << stats.p99 * 1e6 << std::setw(10) << stats.max * 1e6 << "\n"
+            << std::defaultfloat << std::setprecision(6);
+    }
+}
+
+int DumpProfile(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "cannot write stats to " << path << "\n";
+        return FAIL;
+    }
+    PrintProfile(file);
+    return file ? SUCCESS : FAIL;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef _PROFILER_HPP
+#define _PROFILER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+// hot phases with their own timing ring
+enum class Phase {
+    // physics thread, per tick
+    tick,
+    commands,
+    integrate,
+    collisions,
+    conservation,
+    publish,
+    record,
+    replay,
+    // render thread, per frame
+    frame,
+    spheres,
+    upload,
+    draw,
+    count
+};
+
+// summary of the last samples of one phase, s
+struct PhaseStats {
+    unsigned long long total = 0; // samples ever recorded
+    size_t window = 0;            // samples summarized below
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+const char* GetPhaseName(Phase phase);
+
+// adds one sample, lock free and safe from any thread
+void RecordPhase(Phase phase, double seconds);
+// summarizes the rolling window of phase, readers never block writers
+PhaseStats GetPhaseStats(Phase phase);
+
+// prints every phase that has samples, in us
+void PrintProfile(std::ostream& out);
+// writes PrintProfile to path, fails if the file cannot be written
+int DumpProfile(const std::string& path);
+
+// records the time between construction and destruction under phase
+class ScopedTimer {
+    Phase _phase;
+    std::chrono::steady_clock::time_point _start;
+public:
+    explicit ScopedTimer(Phase phase) : _phase(phase), _start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        RecordPhase(_phase, std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count());
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#endif
@@ -0,0 +1,370 @@
+#include "recorder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "definitions.hpp"
+#include "trajectory.hpp"
+
+// frames in flight between the physics and the writer thread, within RecorderOptions::ringBytes
+constexpr size_t maxRingFrames = 32;
+constexpr size_t minRingFrames = 2;
+
+// keeps the prediction arithmetic of the encoder and the reader inside int64_t
+constexpr double maxQuantizedSteps = 1.0e18;
+
+inline int64_t Quantize(double value, double quantum) {
+    double steps = value / quantum;
+    // far out or broken bodies saturate instead of overflowing
+    if (std::isnan(steps)) {
+        return 0;
+    }
+    return llround(std::clamp(steps, -maxQuantizedSteps, maxQuantizedSteps));
+}
+
+template <class T>
+inline void WriteRaw(std::vector<unsigned char>& out, const T& value) {
+    const unsigned char* bytes = (const unsigned char*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+
+int ParseTrajectoryFields(const std::string& text, uint32_t& fields) {
+    if (text == "p") {
+        fields = trajectoryPositions;
+    }
+    else if (text == "v") {
+        fields = trajectoryVelocities;
+    }
+    else if (text == "pv" || text == "vp") {
+        fields = trajectoryPositions | trajectoryVelocities;
+    }
+    else {
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+
+// private
+
+bool Recorder::TableChanged(const BodyStore& bodies) const {
+    if (_table == nullptr || _table->version != bodies.Version()) {
+        return true;
+    }
+    // edits keep the version, these arrays are small next to the frame itself
+    size_t count = bodies.Size();
+    return memcmp(_table->radius.data(), bodies.radius.data(), count * sizeof(double)) != 0
+        || memcmp(_table->luminosity.data(), bodies.luminosity.data(), count * sizeof(float)) != 0
+        || memcmp(_table->red.data(), bodies.red.data(), count * sizeof(float)) != 0
+        || memcmp(_table->green.data(), bodies.green.data(), count * sizeof(float)) != 0
+        || memcmp(_table->blue.data(), bodies.blue.data(), count * sizeof(float)) != 0;
+}
+
+void Recorder::WriterLoop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _wake.wait(lock, [&] { return _stopping || _head.load() != _tail.load(); });
+        }
+        unsigned long long head = _head.load(std::memory_order_acquire);
+        unsigned long long tail = _tail.load(std::memory_order_relaxed);
+        // only changed while the ring is empty, the acquire above orders it
+        size_t slots = _slots.load(std::memory_order_relaxed);
+        for (; tail != head; tail++) {
+            Encode(_ring[tail % slots]);
+            _tail.store(tail + 1, std::memory_order_release);
+        }
+        // the physics thread stops capturing before it sets _stopping
+        if (_stopping && _head.load(std::memory_order_acquire) == tail) {
+            break;
+        }
+    }
+    FlushChunk();
+    uint64_t indexOffset = _offset;
+    for (const TrajectoryIndexEntry& entry: _index) {
+        Write(&entry, sizeof(entry));
+    }
+    TrajectoryFooter footer;
+    footer.indexOffset = indexOffset;
+    footer.chunkCount = _index.size();
+    memcpy(footer.magic, trajectoryIndexMagic, sizeof(footer.magic));
+    Write(&footer, sizeof(footer));
+    _file.close();
+}
+
+void Recorder::Encode(const Frame& frame) {
+    size_t count = frame.table->names.size();
+    if (_chunk.frameCount > 0 && (frame.table != _chunkTable || (int)_chunk.frameCount >= _options.framesPerChunk)) {
+        FlushChunk();
+    }
+    int components = TrajectoryComponents(_options.fields);
+    if (_chunk.frameCount == 0) {
+        _chunkTable = frame.table;
+        memcpy(_chunk.magic, trajectoryChunkMagic, sizeof(_chunk.magic));
+        _chunk.bodyCount = count;
+        _chunk.firstTick = frame.tick;
+        _chunk.firstTime = frame.time;
+        _tableData.clear();
+        _frameData.clear();
+        for (size_t i = 0; i < count; i++) {
+            const std::string& name = frame.table->names[i];
+            WriteVarint(_tableData, name.size());
+            _tableData.insert(_tableData.end(), name.begin(), name.end());
+            WriteRaw(_tableData, frame.table->radius[i]);
+            WriteRaw(_tableData, frame.table->luminosity[i]);
+            WriteRaw(_tableData, frame.table->red[i]);
+            WriteRaw(_tableData, frame.table->green[i]);
+            WriteRaw(_tableData, frame.table->blue[i]);
+        }
+        _previous.assign(components * count, 0);
+        _beforePrevious.assign(components * count, 0);
+    }
+
+    WriteVarint(_frameData, frame.tick - _chunk.firstTick);
+    WriteRaw(_frameData, frame.time);
+    uint32_t frameIndex = _chunk.frameCount;
+    for (int c = 0; c < components; c++) {
+        // positions come first when both are recorded
+        bool position = (_options.fields & trajectoryPositions) && c < 3;
+        double quantum = position ? _options.positionQuantum : _options.velocityQuantum;
+        const double* values = frame.values.data() + c * count;
+        int64_t* previous = _previous.data() + c * count;
+        int64_t* beforePrevious = _beforePrevious.data() + c * count;
+        for (size_t i = 0; i < count; i++) {
+            int64_t value = Quantize(values[i], quantum);
+            int64_t prediction = 0;
+            if (frameIndex == 1) {
+                prediction = previous[i];
+            }
+            else if (frameIndex > 1) {
+                prediction = 2 * previous[i] - beforePrevious[i];
+            }
+            WriteZigzag(_frameData, value - prediction);
+            beforePrevious[i] = previous[i];
+            previous[i] = value;
+        }
+    }
+    _chunk.frameCount++;
+    _chunk.lastTick = frame.tick;
+    _chunk.lastTime = frame.time;
+    _rawBytes.fetch_add(components * count * sizeof(double), std::memory_order_relaxed);
+}
+
+void Recorder::FlushChunk() {
+    if (_chunk.frameCount == 0) {
+        return;
+    }
+    _chunk.tableSize = _tableData.size();
+    _chunk.framesSize = _frameData.size();
+    TrajectoryIndexEntry entry;
+    entry.offset = _offset;
+    entry.firstTick = _chunk.firstTick;
+    entry.firstTime = _chunk.firstTime;
+    entry.lastTime = _chunk.lastTime;
+    _index.push_back(entry);
+    Write(&_chunk, sizeof(_chunk));
+    Write(_tableData.data(), _tableData.size());
+    Write(_frameData.data(), _frameData.size());
+    _file.flush();
+    _chunks.fetch_add(1, std::memory_order_relaxed);
+    memset(&_chunk, 0, sizeof(_chunk));
+    _chunkTable = nullptr;
+}
+
+void Recorder::Write(const void* data, size_t size) {
+    _file.write((const char*)data, size);
+    _offset += size;
+    _bytes.fetch_add(size, std::memory_order_relaxed);
+    if (!_file) {
+        _failed = true;
+    }
+}
+
+
+// public
+
+Recorder::Recorder() {
+    _recording = false;
+    _head = 0;
+    _tail = 0;
+    _slots = minRingFrames;
+    _stopping = false;
+    _offset = 0;
+    _frames = 0;
+    _dropped = 0;
+    _chunks = 0;
+    _bytes = 0;
+    _rawBytes = 0;
+    _failed = false;
+    memset(&_chunk, 0, sizeof(_chunk));
+}
+
+Recorder::~Recorder() {
+    Stop();
+}
+
+bool Recorder::IsRecording() const {
+    return _recording;
+}
+
+int Recorder::Start(const RecorderOptions& options) {
+    if (_recording) {
+        std::cout << "already recording to " << _options.path << "\n";
+        return FAIL;
+    }
+    if (options.decimation < 1 || options.framesPerChunk < 1 || TrajectoryComponents(options.fields) == 0 || options.ringBytes == 0
+        || !(options.positionQuantum > 0.0) || !(options.velocityQuantum > 0.0)) {
+        std::cout << "invalid recording options\n";
+        return FAIL;
+    }
+    _file.open(options.path, std::ios::binary | std::ios::trunc);
+    if (!_file) {
+        std::cout << "cannot write " << options.path << "\n";
+        return FAIL;
+    }
+    _options = options;
+    _ring.assign(maxRingFrames, Frame());
+    _slots = minRingFrames;
+    _head = 0;
+    _tail = 0;
+    _stopping = false;
+    _table = nullptr;
+    _index.clear();
+    _offset = 0;
+    _frames = 0;
+    _dropped = 0;
+    _chunks = 0;
+    _bytes = 0;
+    _rawBytes = 0;
+    _failed = false;
+    memset(&_chunk, 0, sizeof(_chunk));
+
+    TrajectoryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, trajectoryMagic, sizeof(header.magic));
+    header.version = trajectoryVersion;
+    header.byteOrder = byteOrderMark;
+    header.fields = options.fields;
+    header.decimation = options.decimation;
+    header.positionQuantum = options.positionQuantum;
+    header.velocityQuantum = options.velocityQuantum;
+    Write(&header, sizeof(header));
+
+    _writer = std::thread(&Recorder::WriterLoop, this);
+    _recording = true;
+    return SUCCESS;
+}
+
+int Recorder::Stop() {
+    if (!_recording) {
+        return FAIL;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    _writer.join();
+    _recording = false;
+    _table = nullptr;
+    _chunkTable = nullptr;
+    return _failed ? FAIL : SUCCESS;
+}
+
+void Recorder::Capture(const BodyStore& bodies, unsigned long long tick, double time) {
+    if (!_recording || tick % _options.decimation != 0) {
+        return;
+    }
+    size_t count = bodies.Size();
+    // as many slots as fit the byte budget, so huge universes hold a few frames instead of 32
+    size_t frameBytes = std::max<size_t>(TrajectoryComponents(_options.fields) * count * sizeof(double), 1);
+    size_t slots = std::min(maxRingFrames, std::max(minRingFrames, _options.ringBytes / frameBytes));
+    unsigned long long head = _head.load(std::memory_order_relaxed);
+    unsigned long long tail = _tail.load(std::memory_order_acquire);
+    size_t currentSlots = _slots.load(std::memory_order_relaxed);
+    if (slots != currentSlots) {
+        if (head == tail) {
+            // the writer holds no slot, unused ones give their memory back
+            for (size_t i = slots; i < _ring.size(); i++) {
+                std::vector<double>().swap(_ring[i].values);
+                _ring[i].table = nullptr;
+            }
+            _slots.store(slots, std::memory_order_relaxed);
+        }
+        else if (slots < currentSlots) {
+            // frames grew past the budget, wait for the writer to drain before shrinking
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else {
+            // grows once the writer has caught up
+            slots = currentSlots;
+        }
+    }
+    if (head - tail >= slots) {
+        // the writer fell behind, physics never waits for it
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (TableChanged(bodies)) {
+        std::shared_ptr<TrajectoryBodyTable> table = std::make_shared<TrajectoryBodyTable>();
+        table->version = bodies.Version();
+        table->names = bodies.names;
+        table->radius = bodies.radius;
+        table->luminosity = bodies.luminosity;
+        table->red = bodies.red;
+        table->green = bodies.green;
+        table->blue = bodies.blue;
+        _table = table;
+    }
+
+    Frame& frame = _ring[head % slots];
+    frame.tick = tick;
+    frame.time = time;
+    frame.table = _table;
+    frame.values.resize(TrajectoryComponents(_options.fields) * count);
+    double* values = frame.values.data();
+    if (_options.fields & trajectoryPositions) {
+        std::copy(bodies.x.begin(), bodies.x.end(), values);
+        std::copy(bodies.y.begin(), bodies.y.end(), values + count);
+        std::copy(bodies.z.begin(), bodies.z.end(), values + 2 * count);
+        values += 3 * count;
+    }
+    if (_options.fields & trajectoryVelocities) {
+        std::copy(bodies.xVel.begin(), bodies.xVel.end(), values);
+        std::copy(bodies.yVel.begin(), bodies.yVel.end(), values + count);
+        std::copy(bodies.zVel.begin(), bodies.zVel.end(), values + 2 * count);
+    }
+    _head.store(head + 1, std::memory_order_release);
+    _frames.fetch_add(1, std::memory_order_relaxed);
+    {
+        // orders the publish against a writer between its check and its wait
+        std::lock_guard<std::mutex> lock(_mtx);
+    }
+    _wake.notify_one();
+}
+
+RecorderStats Recorder::GetStats() const {
+    RecorderStats stats;
+    stats.recording = _recording;
+    stats.path = _options.path;
+    stats.frames = _frames;
+    stats.dropped = _dropped;
+    stats.chunks = _chunks;
+    stats.bytes = _bytes;
+    stats.rawBytes = _rawBytes;
+    stats.failed = _failed;
+    return stats;
+}
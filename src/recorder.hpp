@@ -0,0 +1,118 @@
+#pragma once
+#ifndef _RECORDER_HPP
+#define _RECORDER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "trajectory.hpp"
+
+struct RecorderOptions {
+    std::string path;
+    // record every decimation-th tick
+    int decimation = 1;
+    // TrajectoryField bits
+    uint32_t fields = trajectoryPositions | trajectoryVelocities;
+    // scaled m and m/s per step, 1 km and 1 mm/s at the default SCALE
+    double positionQuantum = 1e-6;
+    double velocityQuantum = 1e-12;
+    int framesPerChunk = 64;
+    // frames waiting for the writer may hold this many bytes, but there is room for at least 2
+    size_t ringBytes = 256 << 20;
+};
+
+struct RecorderStats {
+    bool recording = false;
+    std::string path;
+    unsigned long long frames = 0;  // handed to the writer
+    unsigned long long dropped = 0; // lost because the ring was full (or over its byte budget)
+    unsigned long long chunks = 0;
+    unsigned long long bytes = 0;    // written to the file
+    unsigned long long rawBytes = 0; // the same frames as plain doubles
+    bool failed = false;
+};
+
+// "p", "v" or "pv" to TrajectoryField bits, fails on anything else
+int ParseTrajectoryFields(const std::string& text, uint32_t& fields);
+
+// streams trajectories to a chunked file (see trajectory.hpp)
+// the physics thread copies frames into a bounded ring and never waits,
+// a writer thread quantizes, delta encodes and appends them
+class Recorder {
+    struct Frame {
+        unsigned long long tick = 0;
+        double time = 0.0;
+        std::shared_ptr<const TrajectoryBodyTable> table;
+        // component c of body i at [c * count + i]
+        std::vector<double> values;
+    };
+
+    RecorderOptions _options;
+    bool _recording;
+
+    // single producer (physics), single consumer (writer)
+    std::vector<Frame> _ring;
+    // slots in use, from the byte budget, only changed by the producer while the ring is empty
+    std::atomic<size_t> _slots;
+    std::atomic<unsigned long long> _head;
+    std::atomic<unsigned long long> _tail;
+    std::mutex _mtx;
+    std::condition_variable _wake;
+    std::atomic<bool> _stopping;
+    std::thread _writer;
+
+    // physics side, reused while the bodies do not change
+    std::shared_ptr<const TrajectoryBodyTable> _table;
+
+    // writer side
+    std::ofstream _file;
+    std::shared_ptr<const TrajectoryBodyTable> _chunkTable;
+    TrajectoryChunkHeader _chunk;
+    std::vector<unsigned char> _tableData;
+    std::vector<unsigned char> _frameData;
+    // quantized values of the last two frames of the chunk
+    std::vector<int64_t> _previous;
+    std::vector<int64_t> _beforePrevious;
+    std::vector<TrajectoryIndexEntry> _index;
+    unsigned long long _offset;
+
+    std::atomic<unsigned long long> _frames;
+    std::atomic<unsigned long long> _dropped;
+    std::atomic<unsigned long long> _chunks;
+    std::atomic<unsigned long long> _bytes;
+    std::atomic<unsigned long long> _rawBytes;
+    std::atomic<bool> _failed;
+
+    bool TableChanged(const BodyStore& bodies) const;
+    void WriterLoop();
+    void Encode(const Frame& frame);
+    void FlushChunk();
+    void Write(const void* data, size_t size);
+public:
+    Recorder();
+    ~Recorder();
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // everything is called from the owning (physics) thread
+    bool IsRecording() const;
+    // fails if already recording, the options are invalid or the file cannot be created
+    int Start(const RecorderOptions& options);
+    // lets the writer drain the ring, then writes the index and closes the file
+    int Stop();
+    // called after every tick, keeps only every decimation-th
+    void Capture(const BodyStore& bodies, unsigned long long tick, double time);
+
+    // totals of the current or last recording
+    RecorderStats GetStats() const;
+};
+
+#endif
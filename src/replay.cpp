@@ -0,0 +1,352 @@
+#include "replay.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "definitions.hpp"
+#include "mappedfile.hpp"
+#include "trajectory.hpp"
+
+
+// private
+
+int Replay::ReadChunkHeader(uint64_t offset, uint64_t end, TrajectoryChunkHeader& chunk) const {
+    if (offset > end || end - offset < sizeof(chunk)) {
+        return FAIL;
+    }
+    memcpy(&chunk, _file.Data() + offset, sizeof(chunk));
+    uint64_t available = end - offset - sizeof(chunk);
+    if (memcmp(chunk.magic, trajectoryChunkMagic, sizeof(chunk.magic)) != 0 || chunk.frameCount == 0
+        || chunk.tableSize > available || chunk.framesSize > available - chunk.tableSize) {
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+int Replay::ReadIndex() {
+    size_t size = _file.Size();
+    if (size < sizeof(TrajectoryHeader) + sizeof(TrajectoryFooter)) {
+        return FAIL;
+    }
+    TrajectoryFooter footer;
+    memcpy(&footer, _file.Data() + size - sizeof(footer), sizeof(footer));
+    uint64_t indexEnd = size - sizeof(footer);
+    if (memcmp(footer.magic, trajectoryIndexMagic, sizeof(footer.magic)) != 0
+        || footer.indexOffset < sizeof(TrajectoryHeader) || footer.indexOffset > indexEnd
+        || footer.chunkCount != (indexEnd - footer.indexOffset) / sizeof(TrajectoryIndexEntry)
+        || (indexEnd - footer.indexOffset) % sizeof(TrajectoryIndexEntry) != 0) {
+        return FAIL;
+    }
+    _index.resize(footer.chunkCount);
+    memcpy(_index.data(), _file.Data() + footer.indexOffset, footer.chunkCount * sizeof(TrajectoryIndexEntry));
+    // the headers are small, this touches one page per chunk
+    for (const TrajectoryIndexEntry& entry: _index) {
+        TrajectoryChunkHeader chunk;
+        if (ReadChunkHeader(entry.offset, footer.indexOffset, chunk) <= FAIL) {
+            _index.clear();
+            _frameCount = 0;
+            return FAIL;
+        }
+        _frameCount += chunk.frameCount;
+    }
+    return SUCCESS;
+}
+
+int Replay::ScanChunks() {
+    uint64_t offset = sizeof(TrajectoryHeader);
+    TrajectoryChunkHeader chunk;
+    // stops at the end or at a chunk the recorder did not finish
+    while (ReadChunkHeader(offset, _file.Size(), chunk) == SUCCESS) {
+        TrajectoryIndexEntry entry;
+        entry.offset = offset;
+        entry.firstTick = chunk.firstTick;
+        entry.firstTime = chunk.firstTime;
+        entry.lastTime = chunk.lastTime;
+        _index.push_back(entry);
+        _frameCount += chunk.frameCount;
+        offset += sizeof(chunk) + chunk.tableSize + chunk.framesSize;
+    }
+    return SUCCESS;
+}
+
+int Replay::StartChunk(size_t chunk, BodyStore& bodies) {
+    uint64_t offset = _index[chunk].offset;
+    if (ReadChunkHeader(offset, _file.Size(), _chunkHeader) <= FAIL) {
+        return FAIL;
+    }
+    const unsigned char* table = _file.Data() + offset + sizeof(_chunkHeader);
+    uint64_t count = _chunkHeader.bodyCount;
+    // consecutive chunks repeat the table until the bodies change
+    if (_table == nullptr || _tableSize != _chunkHeader.tableSize || bodies.Size() != count
+        || memcmp(_table, table, _tableSize) != 0) {
+        if (LoadTable(table, _chunkHeader.tableSize, count, bodies) <= FAIL) {
+            return FAIL;
+        }
+    }
+    _chunk = chunk;
+    _frame = 0;
+    _cursor = table + _chunkHeader.tableSize;
+    _end = _cursor + _chunkHeader.framesSize;
+    size_t values = TrajectoryComponents(_header.fields) * count;
+    _previous.assign(values, 0);
+    _beforePrevious.assign(values, 0);
+    if (chunk + 1 < _index.size()) {
+        // playback moves on to the next chunk soon, which is about as large
+        _file.Prefetch(_index[chunk + 1].offset, sizeof(_chunkHeader) + _chunkHeader.tableSize + _chunkHeader.framesSize);
+    }
+    return SUCCESS;
+}
+
+int Replay::LoadTable(const unsigned char* data, uint64_t size, uint64_t count, BodyStore& bodies) {
+    const unsigned char* end = data + size;
+    // every body takes at least a length byte, radius and four floats
+    if (count > size / (1 + sizeof(double) + 4 * sizeof(float))) {
+        return FAIL;
+    }
+    bodies.names.resize(count);
+    bodies.radius.resize(count);
+    bodies.luminosity.resize(count);
+    bodies.red.resize(count);
+    bodies.green.resize(count);
+    bodies.blue.resize(count);
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t length;
+        if (!ReadVarint(data, end, length) || length > (uint64_t)(end - data)) {
+            bodies.Clear();
+            return FAIL;
+        }
+        bodies.names[i].assign((const char*)data, length);
+        data += length;
+        if ((size_t)(end - data) < sizeof(double) + 4 * sizeof(float)) {
+            bodies.Clear();
+            return FAIL;
+        }
+        memcpy(&bodies.radius[i], data, sizeof(double));
+        data += sizeof(double);
+        for (std::vector<float>* attribute: { &bodies.luminosity, &bodies.red, &bodies.green, &bodies.blue }) {
+            memcpy(&(*attribute)[i], data, sizeof(float));
+            data += sizeof(float);
+        }
+    }
+    // not recorded, so zero
+    for (std::vector<double>* array: { &bodies.x, &bodies.y, &bodies.z, &bodies.xVel, &bodies.yVel, &bodies.zVel,
+        &bodies.mass, &bodies.xAcc, &bodies.yAcc, &bodies.zAcc,
+        &bodies.theta, &bodies.phi, &bodies.psi, &bodies.thetaVel, &bodies.phiVel, &bodies.psiVel }) {
+        array->assign(count, 0.0);
+    }
+    if (bodies.Rebuild() <= FAIL) {
+        _table = nullptr;
+        return FAIL;
+    }
+    _table = end - size;
+    _tableSize = size;
+    return SUCCESS;
+}
+
+bool Replay::PeekTime(double& time) const {
+    if (_chunk == npos || _frame >= _chunkHeader.frameCount) {
+        return false;
+    }
+    const unsigned char* cursor = _cursor;
+    uint64_t tickDelta;
+    if (!ReadVarint(cursor, _end, tickDelta) || (size_t)(_end - cursor) < sizeof(double)) {
+        return false;
+    }
+    memcpy(&time, cursor, sizeof(double));
+    return true;
+}
+
+int Replay::DecodeFrame(BodyStore& bodies) {
+    size_t count = _chunkHeader.bodyCount;
+    if (_frame >= _chunkHeader.frameCount) {
+        return FAIL;
+    }
+    // bodies edited from the console since the chunk started
+    if (bodies.Size() != count && LoadTable(_file.Data() + _index[_chunk].offset + sizeof(_chunkHeader),
+        _chunkHeader.tableSize, count, bodies) <= FAIL) {
+        return FAIL;
+    }
+    uint64_t tickDelta;
+    if (!ReadVarint(_cursor, _end, tickDelta) || (size_t)(_end - _cursor) < sizeof(double)) {
+        return FAIL;
+    }
+    memcpy(&_time, _cursor, sizeof(double));
+    _cursor += sizeof(double);
+    _tick = _chunkHeader.firstTick + tickDelta;
+
+    std::vector<double>* arrays[6];
+    int components = 0;
+    if (_header.fields & trajectoryPositions) {
+        arrays[components++] = &bodies.x;
+        arrays[components++] = &bodies.y;
+        arrays[components++] = &bodies.z;
+    }
+    if (_header.fields & trajectoryVelocities) {
+        arrays[components++] = &bodies.xVel;
+        arrays[components++] = &bodies.yVel;
+        arrays[components++] = &bodies.zVel;
+    }
+    for (int c = 0; c < components; c++) {
+        bool position = (_header.fields & trajectoryPositions) && c < 3;
+        double quantum = position ? _header.positionQuantum : _header.velocityQuantum;
+        double* values = arrays[c]->data();
+        int64_t* previous = _previous.data() + c * count;
+        int64_t* beforePrevious = _beforePrevious.data() + c * count;
+        for (size_t i = 0; i < count; i++) {
+            int64_t residual;
+            if (!ReadZigzag(_cursor, _end, residual)) {
+                return FAIL;
+            }
+            // unsigned, so a damaged file wraps instead of overflowing
+            uint64_t prediction = 0;
+            if (_frame == 1) {
+                prediction = previous[i];
+            }
+            else if (_frame > 1) {
+                prediction = 2 * (uint64_t)previous[i] - (uint64_t)beforePrevious[i];
+            }
+            int64_t value = (int64_t)((uint64_t)residual + prediction);
+            beforePrevious[i] = previous[i];
+            previous[i] = value;
+            values[i] = value * quantum;
+        }
+    }
+    _frame++;
+    return SUCCESS;
+}
+
+
+// public
+
+Replay::Replay() {
+    memset(&_header, 0, sizeof(_header));
+    memset(&_chunkHeader, 0, sizeof(_chunkHeader));
+    _indexed = false;
+    _frameCount = 0;
+    _chunk = npos;
+    _frame = 0;
+    _cursor = nullptr;
+    _end = nullptr;
+    _table = nullptr;
+    _tableSize = 0;
+    _tick = 0;
+    _time = 0.0;
+}
+
+int Replay::Open(const std::string& path) {
+    _index.clear();
+    _frameCount = 0;
+    _chunk = npos;
+    _table = nullptr;
+    if (_file.Open(path) <= FAIL) {
+        std::cout << "cannot open " << path << "\n";
+        return FAIL;
+    }
+    _path = path;
+    if (_file.Size() < sizeof(_header)) {
+        std::cout << path << " is not a trajectory\n";
+        _file.Close();
+        return FAIL;
+    }
+    memcpy(&_header, _file.Data(), sizeof(_header));
+    if (memcmp(_header.magic, trajectoryMagic, sizeof(_header.magic)) != 0) {
+        std::cout << path << " is not a trajectory\n";
+        _file.Close();
+        return FAIL;
+    }
+    if (_header.version != trajectoryVersion || _header.byteOrder != byteOrderMark
+        || TrajectoryComponents(_header.fields) == 0 || !(_header.positionQuantum > 0.0) || !(_header.velocityQuantum > 0.0)) {
+        std::cout << path << " has trajectory version " << _header.version << ", expected " << trajectoryVersion << " (same byte order)\n";
+        _file.Close();
+        return FAIL;
+    }
+    _file.AdviseSequential();
+    _indexed = ReadIndex() == SUCCESS;
+    if (!_indexed) {
+        ScanChunks();
+    }
+    if (_index.empty()) {
+        std::cout << path << " has no complete chunk\n";
+        _file.Close();
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+double Replay::GetFirstTime() const {
+    return _index.empty() ? 0.0 : _index.front().firstTime;
+}
+
+double Replay::GetLastTime() const {
+    return _index.empty() ? 0.0 : _index.back().lastTime;
+}
+
+unsigned long long Replay::GetTick() const {
+    return _tick;
+}
+
+double Replay::GetTime() const {
+    return _time;
+}
+
+bool Replay::AtEnd() const {
+    return _chunk != npos && _chunk + 1 >= _index.size() && _frame >= _chunkHeader.frameCount;
+}
+
+int Replay::Seek(double time, BodyStore& bodies) {
+    if (_index.empty()) {
+        return FAIL;
+    }
+    // last chunk starting at or before time
+    size_t chunk = std::upper_bound(_index.begin(), _index.end(), time,
+        [](double t, const TrajectoryIndexEntry& entry) { return t < entry.firstTime; }) - _index.begin();
+    chunk = chunk > 0 ? chunk - 1 : 0;
+    if (StartChunk(chunk, bodies) <= FAIL || DecodeFrame(bodies) <= FAIL) {
+        _chunk = npos;
+        return FAIL;
+    }
+    double next;
+    while (PeekTime(next) && next <= time) {
+        if (DecodeFrame(bodies) <= FAIL) {
+            _chunk = npos;
+            return FAIL;
+        }
+    }
+    return SUCCESS;
+}
+
+int Replay::Advance(double time, BodyStore& bodies) {
+    // a chunk decodes from its start, so jumping to a later one costs no more than stepping into it
+    if (_chunk == npos || (_chunk + 1 < _index.size() && _index[_chunk + 1].firstTime <= time)) {
+        return Seek(time, bodies) <= FAIL ? FAIL : 1;
+    }
+    int frames = 0;
+    double next;
+    while (PeekTime(next) && next <= time) {
+        if (DecodeFrame(bodies) <= FAIL) {
+            _chunk = npos;
+            return FAIL;
+        }
+        frames++;
+    }
+    return frames;
+}
+
+ReplayStats Replay::GetStats() const {
+    ReplayStats stats;
+    stats.replaying = _file.IsOpen();
+    stats.path = _path;
+    stats.frames = _frameCount;
+    stats.chunks = _index.size();
+    stats.indexed = _indexed;
+    stats.firstTime = GetFirstTime();
+    stats.lastTime = GetLastTime();
+    stats.tick = _tick;
+    stats.time = _time;
+    return stats;
+}
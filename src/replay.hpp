@@ -0,0 +1,92 @@
+#pragma once
+#ifndef _REPLAY_HPP
+#define _REPLAY_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "mappedfile.hpp"
+#include "trajectory.hpp"
+
+struct ReplayStats {
+    bool replaying = false;
+    std::string path;
+    unsigned long long frames = 0;
+    unsigned long long chunks = 0;
+    // false if the file had no index (recording cut short) and the chunks were walked instead
+    bool indexed = false;
+    // s
+    double firstTime = 0.0;
+    double lastTime = 0.0;
+    // last decoded frame
+    unsigned long long tick = 0;
+    double time = 0.0;
+};
+
+// plays a trajectory file (see trajectory.hpp) back into a BodyStore
+// the file is memory mapped, so only the chunks that are shown are ever read
+// seeking looks the chunk up in the index and decodes at most one chunk
+class Replay {
+    MappedFile _file;
+    std::string _path;
+    TrajectoryHeader _header;
+    std::vector<TrajectoryIndexEntry> _index;
+    bool _indexed;
+    unsigned long long _frameCount;
+
+    // decoding state, _chunk is npos before the first Seek
+    size_t _chunk;
+    TrajectoryChunkHeader _chunkHeader;
+    uint32_t _frame; // frames of _chunk decoded so far
+    const unsigned char* _cursor;
+    const unsigned char* _end;
+    // quantized values of the last two frames of the chunk
+    std::vector<int64_t> _previous;
+    std::vector<int64_t> _beforePrevious;
+    // body table the store was filled from
+    const unsigned char* _table;
+    uint64_t _tableSize;
+    unsigned long long _tick;
+    double _time;
+
+    // reads the chunk header at offset, fails unless it lies completely before end
+    int ReadChunkHeader(uint64_t offset, uint64_t end, TrajectoryChunkHeader& chunk) const;
+    int ReadIndex();
+    int ScanChunks();
+    // positions the decoder before the first frame of chunk, refills the bodies if its table differs
+    int StartChunk(size_t chunk, BodyStore& bodies);
+    int LoadTable(const unsigned char* data, uint64_t size, uint64_t count, BodyStore& bodies);
+    // time of the next frame in the current chunk, false if there is none
+    bool PeekTime(double& time) const;
+    int DecodeFrame(BodyStore& bodies);
+public:
+    static constexpr size_t npos = ~size_t(0);
+
+    Replay();
+    Replay(const Replay&) = delete;
+    Replay& operator=(const Replay&) = delete;
+
+    // maps the file and reads its index, fails if it is not a trajectory or has no complete chunk
+    int Open(const std::string& path);
+
+    double GetFirstTime() const;
+    double GetLastTime() const;
+    // of the last decoded frame
+    unsigned long long GetTick() const;
+    double GetTime() const;
+    // the last frame was decoded
+    bool AtEnd() const;
+
+    // replaces bodies with the last frame at or before time (the first frame if time is earlier)
+    // the bodies get their recorded names, radii and colors, masses are not recorded and stay 0
+    int Seek(double time, BodyStore& bodies);
+    // moves forward to the last frame at or before time, through the index if that is past the current chunk
+    // returns the frames decoded, or FAIL
+    int Advance(double time, BodyStore& bodies);
+
+    ReplayStats GetStats() const;
+};
+
+#endif
@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec3 pointColor;
+
+out vec4 FragColor;
+
+void main() {
+    // round, fading towards the edge
+    vec2 offset = gl_PointCoord - vec2(0.5f);
+    float distanceSquared = dot(offset, offset);
+    if (distanceSquared > 0.25f) {
+        discard;
+    }
+    FragColor = vec4(pointColor * (1.0f - 4.0f * distanceSquared), 1.0f);
+}
@@ -0,0 +1,26 @@
+#version 330 core
+
+float zNear = 0.0000000001;
+float zFar = 1000000000.0;
+float fCoeff = 1.0 / log2(zFar + 1.0);
+
+uniform mat4 projectionMatrix;
+uniform mat4 viewMatrix;
+// diameter of the heaviest or most luminous bodies, px
+uniform float maxPointSize;
+
+// one point per body, see CloudPoint
+layout (location = 0) in vec3 iPosition;
+// rgb and weight (log mass or luminosity, 0 to 1)
+layout (location = 1) in vec4 iColor;
+
+out vec3 pointColor;
+
+void main() {
+    gl_Position = projectionMatrix * viewMatrix * vec4(iPosition, 1.0f);
+    // only keeps the far plane from clipping, the depth test is off for additive points
+    gl_Position.z = log2(max(zNear, 1.0 + gl_Position.w)) * fCoeff * 2.0 - 1.0;
+    gl_PointSize = mix(1.0, maxPointSize, iColor.a * iColor.a);
+    // light bodies stay faint, overlapping ones add up
+    pointColor = iColor.rgb * mix(0.15, 1.0, iColor.a);
+}
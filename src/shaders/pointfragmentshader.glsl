@@ -0,0 +1,16 @@
+#version 330 core
+
+in vec3 pointColor;
+in float fragDepth;
+
+out vec4 FragColor;
+
+void main() {
+    // round instead of square points
+    vec2 offset = gl_PointCoord - vec2(0.5f);
+    if (dot(offset, offset) > 0.25f) {
+        discard;
+    }
+    FragColor = vec4(pointColor, 1.0f);
+    gl_FragDepth = fragDepth;
+}
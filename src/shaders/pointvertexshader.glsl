@@ -0,0 +1,38 @@
+#version 330 core
+
+float zNear = 0.0000000001;
+float zFar = 1000000000.0;
+float fCoeff = 1.0 / log2(zFar + 1.0);
+
+uniform mat4 projectionMatrix;
+uniform mat4 viewMatrix;
+uniform vec3 lightPos;
+uniform vec3 cameraPos;
+// px per unit of radius / distance
+uniform float pixelScale;
+// largest impostor diameter, px
+uniform float maxPointSize;
+
+// one point per body, same layout as the sphere instances
+layout (location = 0) in vec3 iPosition;
+layout (location = 1) in float iRadius;
+layout (location = 2) in vec3 iColor;
+layout (location = 3) in float iLuminosity;
+
+out vec3 pointColor;
+out float fragDepth;
+
+void main() {
+    gl_Position = projectionMatrix * viewMatrix * vec4(iPosition, 1.0f);
+    gl_PointSize = clamp(2.0 * iRadius * pixelScale / max(gl_Position.w, zNear), 1.0, maxPointSize);
+    gl_Position.z = log2(max(zNear, 1.0 + gl_Position.w)) * fCoeff * 2.0 - 1.0;
+    fragDepth = log2(1.0 + gl_Position.w) * fCoeff;
+    // lit fraction of the visible disk, from the angle between camera and light (the light itself is lit)
+    vec3 toLight = lightPos - iPosition;
+    vec3 toCamera = cameraPos - iPosition;
+    float phase = 1.0f;
+    if (dot(toLight, toLight) > 0.0 && dot(toCamera, toCamera) > 0.0) {
+        phase = 0.5 + 0.5 * dot(normalize(toCamera), normalize(toLight));
+    }
+    pointColor = iColor * min(phase + iLuminosity, 1.0f);
+}
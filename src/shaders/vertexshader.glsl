@@ -7,26 +7,35 @@ float fCoeff = 1.0 / log2(zFar + 1.0);
 uniform mat4 projectionMatrix;
 uniform mat4 viewMatrix;
 
+// unit sphere, shared by every body
 layout (location = 0) in vec3 vPos;
-layout (location = 1) in vec3 vColor;
-layout (location = 2) in vec2 vTexCoords;
-layout (location = 3) in float vMinBrightness;
-layout (location = 4) in vec3 vNormals;
+layout (location = 1) in float vInvert;
+// per body
+layout (location = 2) in vec3 iPosition;
+layout (location = 3) in float iRadius;
+layout (location = 4) in vec3 iColor;
+layout (location = 5) in float iLuminosity;
+layout (location = 6) in float iTheta;
 
 out vec3 vertexPos;
 out vec3 vertexColor;
-out vec2 vertexTexCoords;
 out float vertexMinBrightness;
 out vec3 vertexNormal;
 out float fragDepth;
 
 void main() {
-    gl_Position = projectionMatrix * viewMatrix * vec4(vPos.x, vPos.y, vPos.z, 1.0f);
+    // spin around the body's z axis
+    float theta = radians(iTheta);
+    float c = cos(theta);
+    float s = sin(theta);
+    vec3 normal = vec3(c * vPos.x - s * vPos.y, s * vPos.x + c * vPos.y, vPos.z);
+    vec3 position = iPosition + iRadius * normal;
+
+    gl_Position = projectionMatrix * viewMatrix * vec4(position, 1.0f);
     gl_Position.z = log2(max(zNear, 1.0 + gl_Position.w)) * fCoeff * 2.0 - 1.0;
     fragDepth = log2(1.0 + gl_Position.w) * fCoeff;
-    vertexPos = vPos;
-    vertexColor = vColor;
-    //vertexTexCoords = vec2(vTexCoords.x, vTexCoords.y * -1.0f);
-    vertexMinBrightness = vMinBrightness;
-    vertexNormal = vNormals;
+    vertexPos = position;
+    vertexColor = mix(iColor, vec3(1.0f) - iColor, vInvert);
+    vertexMinBrightness = iLuminosity;
+    vertexNormal = normal;
 }
@@ -0,0 +1,38 @@
+#include "snapshot.hpp"
+
+#include <string>
+#include <vector>
+
+#include "bodystore.hpp"
+
+size_t Snapshot::Size() const {
+    return x.size();
+}
+
+size_t Snapshot::IndexOf(const std::string& name) const {
+    for (size_t i = 0; i < names.size(); i++) {
+        if (names[i] == name) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+void Snapshot::Fill(const BodyStore& bodies, unsigned long long tick, double simulatedTime) {
+    this->tick = tick;
+    this->simulatedTime = simulatedTime;
+    x = bodies.x;
+    y = bodies.y;
+    z = bodies.z;
+    theta = bodies.theta;
+    radius = bodies.radius;
+    mass = bodies.mass;
+    luminosity = bodies.luminosity;
+    red = bodies.red;
+    green = bodies.green;
+    blue = bodies.blue;
+    if (namesVersion != bodies.Version()) {
+        names = bodies.names;
+        namesVersion = bodies.Version();
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+#ifndef _SNAPSHOT_HPP
+#define _SNAPSHOT_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bodystore.hpp"
+
+// what readers outside the physics thread see of one completed tick
+struct Snapshot {
+    static constexpr size_t npos = ~size_t(0);
+
+    unsigned long long tick = 0;
+    // s
+    double simulatedTime = 0.0;
+
+    // m
+    std::vector<double> x, y, z;
+    // degrees
+    std::vector<double> theta;
+    // m
+    std::vector<double> radius;
+    // kg, 0 for replayed bodies
+    std::vector<double> mass;
+    std::vector<float> luminosity;
+    std::vector<float> red, green, blue;
+    std::vector<std::string> names;
+    // BodyStore::Version() names were copied at
+    uint64_t namesVersion = ~uint64_t(0);
+
+    size_t Size() const;
+    // linear search
+    size_t IndexOf(const std::string& name) const;
+
+    // reuses capacity, names are only copied when the store's version changed
+    void Fill(const BodyStore& bodies, unsigned long long tick, double simulatedTime);
+};
+
+// lock-free hand over of the newest value from one writer to a fixed number of readers
+// readers + 2 slots: one being written, the newest, and one pinned per reader
+// neither side ever waits, readers always see a completely written value
+template <class T>
+class TripleBuffer {
+    std::unique_ptr<T[]> _slots;
+    std::unique_ptr<std::atomic<int>[]> _pins;
+    std::unique_ptr<int[]> _held;
+    int _slotCount;
+    int _readerCount;
+    std::atomic<int> _registered;
+    std::atomic<int> _latest;
+    int _writing;
+public:
+    explicit TripleBuffer(int readers = 1) {
+        _readerCount = readers;
+        _slotCount = readers + 2;
+        _slots.reset(new T[_slotCount]);
+        _pins.reset(new std::atomic<int>[_slotCount]);
+        for (int i = 0; i < _slotCount; i++) {
+            _pins[i] = 0;
+        }
+        _held.reset(new int[readers]);
+        for (int i = 0; i < readers; i++) {
+            _held[i] = -1;
+        }
+        _registered = 0;
+        _latest = -1;
+        _writing = -1;
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // reader id in [0, readers), or -1 when all are taken
+    int RegisterReader() {
+        int reader = _registered.fetch_add(1);
+        return reader < _readerCount ? reader : -1;
+    }
+
+    bool HasReaders() const {
+        return _registered.load(std::memory_order_relaxed) > 0;
+    }
+
+    // writer side, only one thread
+
+    // slot to fill, holds an older value whose capacity can be reused
+    T& WriteBuffer() {
+        if (_writing < 0) {
+            // at most readers slots are pinned and one is the newest, so one is always free
+            int latest = _latest.load();
+            for (int i = 0; i < _slotCount; i++) {
+                if (i != latest && _pins[i].load() == 0) {
+                    _writing = i;
+                    break;
+                }
+            }
+        }
+        return _slots[_writing];
+    }
+
+    // makes the filled WriteBuffer the newest value
+    void Publish() {
+        if (_writing < 0) {
+            return;
+        }
+        _latest.store(_writing);
+        _writing = -1;
+    }
+
+    // reader side, each reader id used by one thread at a time
+
+    // newest value, nullptr before the first Publish
+    // stays valid and unchanged until the next Acquire / Release of this reader
+    const T* Acquire(int reader) {
+        Release(reader);
+        while (true) {
+            int latest = _latest.load();
+            if (latest < 0) {
+                return nullptr;
+            }
+            _pins[latest].fetch_add(1);
+            // the writer may have picked this slot before it was pinned, only keep it if it is still the newest
+            if (_latest.load() == latest) {
+                _held[reader] = latest;
+                return &_slots[latest];
+            }
+            _pins[latest].fetch_sub(1);
+        }
+    }
+
+    void Release(int reader) {
+        if (_held[reader] >= 0) {
+            _pins[_held[reader]].fetch_sub(1);
+            _held[reader] = -1;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "solver.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "definitions.hpp"
+#include "gravity.hpp"
+#include "threadpool.hpp"
+#include "values.hpp"
+
+SolverError EstimateSolverError(Solver& solver, const BodyStore& bodies, const GravityParams& params, ThreadPool& pool, size_t samples) {
+    SolverError result;
+    size_t count = bodies.Size();
+    if (count == 0 || samples == 0) {
+        return result;
+    }
+    // both sides see the same positions
+    BodyStore scratch = bodies;
+    solver.ComputeAccelerations(scratch, params, pool);
+    samples = std::min(samples, count);
+    GravitySources sources = { bodies.x.data(), bodies.y.data(), bodies.z.data(), bodies.mass.data(), count };
+    double sum = 0.0;
+    for (size_t s = 0; s < samples; s++) {
+        size_t i = s * count / samples;
+        double ax = 0.0, ay = 0.0, az = 0.0;
+        AccumulateAcceleration(sources, 0, count, bodies.x[i], bodies.y[i], bodies.z[i], params, ax, ay, az);
+        double dx = scratch.xAcc[i] - ax;
+        double dy = scratch.yAcc[i] - ay;
+        double dz = scratch.zAcc[i] - az;
+        double exact = sqrt((ax * ax) + (ay * ay) + (az * az));
+        double error = exact > 0.0 ? sqrt((dx * dx) + (dy * dy) + (dz * dz)) / exact : 0.0;
+        result.max = std::max(result.max, error);
+        sum += error * error;
+    }
+    result.rms = sqrt(sum / samples);
+    return result;
+}
+
+
+// Solver
+
+int Solver::ComputeActiveAccelerations(BodyStore& bodies, const std::vector<uint32_t>& active,
+    const GravityParams& params, ThreadPool& pool) {
+    return ComputeAccelerations(bodies, params, pool);
+}
+
+double Solver::ComputePotential(const BodyStore& bodies, const GravityParams& params, ThreadPool& pool) {
+    size_t count = bodies.Size();
+    double Gg = G * params.gravityScaling;
+    std::vector<double> partials(pool.GetThreadCount(), 0.0);
+    // rows p and count - 1 - p together give every item the same number of pairs
+    size_t rowPairs = (count + 1) / 2;
+    pool.ParallelFor(rowPairs, [&](int thread, size_t begin, size_t end) {
+        double sum = 0.0;
+        for (size_t p = begin; p < end; p++) {
+            size_t rows[2] = { p, count - 1 - p };
+            for (int r = 0; r < (rows[0] == rows[1] ? 1 : 2); r++) {
+                size_t i = rows[r];
+                double x = bodies.x[i], y = bodies.y[i], z = bodies.z[i];
+                double row = 0.0;
+                for (size_t j = i + 1; j < count; j++) {
+                    double dx = bodies.x[j] - x;
+                    double dy = bodies.y[j] - y;
+                    double dz = bodies.z[j] - z;
+                    double distanceSquared = (dx * dx) + (dy * dy) + (dz * dz);
+                    // same cutoff as the force kernels
+                    if (distanceSquared < 1e-36) {
+                        continue;
+                    }
+                    row += bodies.mass[j] / sqrt(distanceSquared);
+                }
+                sum -= Gg * bodies.mass[i] * row;
+            }
+        }
+        partials[thread] += sum;
+    }, minTargetsPerThread / 2);
+    // summed in thread order, so the result does not depend on scheduling
+    double potential = 0.0;
+    for (double partial: partials) {
+        potential += partial;
+    }
+    return potential;
+}
+
+
+// DirectSolver
+
+const char* DirectSolver::GetName() const {
+    return "direct";
+}
+
+int DirectSolver::ComputeAccelerations(BodyStore& bodies, const GravityParams& params, ThreadPool& pool) {
+    size_t count = bodies.Size();
+    GravitySources sources = { bodies.x.data(), bodies.y.data(), bodies.z.data(), bodies.mass.data(), count };
+    // each thread owns a contiguous range of targets and sums every source in the same order,
+    // so results do not depend on the thread count
+    pool.ParallelFor(count, [&](int thread, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            bodies.xAcc[i] = 0.0;
+            bodies.yAcc[i] = 0.0;
+            bodies.zAcc[i] = 0.0;
+            AccumulateAcceleration(sources, 0, count, bodies.x[i], bodies.y[i], bodies.z[i], params,
+                bodies.xAcc[i], bodies.yAcc[i], bodies.zAcc[i]);
+        }
+    }, minTargetsPerThread);
+    return SUCCESS;
+}
+
+int DirectSolver::ComputeActiveAccelerations(BodyStore& bodies, const std::vector<uint32_t>& active,
+    const GravityParams& params, ThreadPool& pool) {
+    size_t count = bodies.Size();
+    GravitySources sources = { bodies.x.data(), bodies.y.data(), bodies.z.data(), bodies.mass.data(), count };
+    pool.ParallelFor(active.size(), [&](int thread, size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            size_t i = active[k];
+            bodies.xAcc[i] = 0.0;
+            bodies.yAcc[i] = 0.0;
+            bodies.zAcc[i] = 0.0;
+            AccumulateAcceleration(sources, 0, count, bodies.x[i], bodies.y[i], bodies.z[i], params,
+                bodies.xAcc[i], bodies.yAcc[i], bodies.zAcc[i]);
+        }
+    }, minTargetsPerThread);
+    return SUCCESS;
+}
+
+
+// SymmetricSolver
+
+const char* SymmetricSolver::GetName() const {
+    return "symmetric";
+}
+
+int SymmetricSolver::ComputeAccelerations(BodyStore& bodies, const GravityParams& params, ThreadPool& pool) {
+    size_t count = bodies.Size();
+    GravitySources sources = { bodies.x.data(), bodies.y.data(), bodies.z.data(), bodies.mass.data(), count };
+    // buffers stay zeroed between calls, the reduction clears what it reads
+    _buffers.resize(pool.GetThreadCount());
+    for (ForceBuffer& buffer: _buffers) {
+        if (buffer.x.size() != count) {
+            buffer.x.assign(count, 0.0);
+            buffer.y.assign(count, 0.0);
+            buffer.z.assign(count, 0.0);
+        }
+    }
+
+    // row i holds the pairs (i, j > i), so rows shrink with i
+    // rows p and count - 1 - p are taken together to give every item the same work
+    size_t rowPairs = (count + 1) / 2;
+    pool.ParallelFor(rowPairs, [&](int thread, size_t begin, size_t end) {
+        ForceBuffer& buffer = _buffers[thread];
+        for (size_t p = begin; p < end; p++) {
+            AccumulatePairAccelerations(sources, p, p + 1, count, params, buffer.x.data(), buffer.y.data(), buffer.z.data());
+            size_t mirror = count - 1 - p;
+            if (mirror != p) {
+                AccumulatePairAccelerations(sources, mirror, mirror + 1, count, params, buffer.x.data(), buffer.y.data(), buffer.z.data());
+            }
+        }
+    }, minTargetsPerThread / 2);
+
+    pool.ParallelFor(count, [&](int thread, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            double ax = 0.0, ay = 0.0, az = 0.0;
+            for (ForceBuffer& buffer: _buffers) {
+                ax += buffer.x[i];
+                ay += buffer.y[i];
+                az += buffer.z[i];
+                buffer.x[i] = 0.0;
+                buffer.y[i] = 0.0;
+                buffer.z[i] = 0.0;
+            }
+            bodies.xAcc[i] = ax;
+            bodies.yAcc[i] = ay;
+            bodies.zAcc[i] = az;
+        }
+    }, minTargetsPerThread);
+    return SUCCESS;
+}
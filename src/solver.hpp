@@ -0,0 +1,63 @@
+#pragma once
+#ifndef _SOLVER_HPP
+#define _SOLVER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "bodystore.hpp"
+#include "gravity.hpp"
+#include "threadpool.hpp"
+
+// evaluates gravitational accelerations for a whole universe
+class Solver {
+public:
+    virtual ~Solver() {}
+
+    virtual const char* GetName() const = 0;
+
+    // writes the acceleration of every body to bodies.xAcc, yAcc, zAcc
+    virtual int ComputeAccelerations(BodyStore& bodies, const GravityParams& params, ThreadPool& pool) = 0;
+
+    // like ComputeAccelerations, but only the bodies at the store indices in active need to be updated
+    // others may be left untouched or overwritten, the default evaluates everything
+    virtual int ComputeActiveAccelerations(BodyStore& bodies, const std::vector<uint32_t>& active,
+        const GravityParams& params, ThreadPool& pool);
+
+    // newtonian potential energy of all pairs (J)
+    // the default is the exact O(N^2) sum, tree solvers approximate it
+    virtual double ComputePotential(const BodyStore& bodies, const GravityParams& params, ThreadPool& pool);
+};
+
+// relative to the exact sum
+struct SolverError {
+    double rms = 0.0;
+    double max = 0.0;
+};
+
+// evaluates solver on a copy of bodies and compares it with an exact sum for up to samples evenly spaced bodies
+// the accelerations cached in bodies may be older than the positions (drift last integrators, block steps)
+SolverError EstimateSolverError(Solver& solver, const BodyStore& bodies, const GravityParams& params, ThreadPool& pool, size_t samples);
+
+// exact O(N^2) sum over all pairs
+class DirectSolver : public Solver {
+public:
+    const char* GetName() const override;
+    int ComputeAccelerations(BodyStore& bodies, const GravityParams& params, ThreadPool& pool) override;
+    int ComputeActiveAccelerations(BodyStore& bodies, const std::vector<uint32_t>& active,
+        const GravityParams& params, ThreadPool& pool) override;
+};
+
+// exact sum that evaluates each unordered pair once and applies it to both bodies
+// every thread accumulates into its own buffers, which are summed in thread order afterwards
+class SymmetricSolver : public Solver {
+    struct ForceBuffer {
+        std::vector<double> x, y, z;
+    };
+    std::vector<ForceBuffer> _buffers;
+public:
+    const char* GetName() const override;
+    int ComputeAccelerations(BodyStore& bodies, const GravityParams& params, ThreadPool& pool) override;
+};
+
+#endif
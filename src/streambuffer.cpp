@@ -0,0 +1,130 @@
+#include "streambuffer.hpp"
+
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include "definitions.hpp"
+
+// regions start on this many bytes, attribute offsets into them stay aligned
+constexpr size_t regionAlignment = 256;
+// how long to wait on a fence between checks (ns)
+constexpr GLuint64 fenceTimeout = 1000000;
+
+StreamBuffer::StreamBuffer() {
+    _buffer = 0;
+    _regionSize = 0;
+    _region = 0;
+    for (void*& fence: _fences) {
+        fence = nullptr;
+    }
+    _mappedSize = 0;
+}
+
+int StreamBuffer::Create() {
+    glGenBuffers(1, &_buffer);
+    return _buffer != 0 ? SUCCESS : FAIL;
+}
+
+unsigned int StreamBuffer::GetBuffer() const {
+    return _buffer;
+}
+
+StreamStats StreamBuffer::GetStats() const {
+    return _stats;
+}
+
+void StreamBuffer::WaitRegion(int region) {
+    GLsync fence = (GLsync)_fences[region];
+    if (fence == nullptr) {
+        return;
+    }
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        _stats.stalls++;
+        // the flush makes sure the fence is submitted, otherwise this could wait forever
+        do {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout);
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    _fences[region] = nullptr;
+}
+
+void StreamBuffer::Reallocate(size_t size) {
+    // the old storage is orphaned, the driver keeps it until pending draws are done
+    for (void*& fence: _fences) {
+        if (fence != nullptr) {
+            glDeleteSync((GLsync)fence);
+            fence = nullptr;
+        }
+    }
+    // half again as much, so slowly growing body counts do not reallocate every frame
+    size += size / 2;
+    _regionSize = (size + regionAlignment - 1) / regionAlignment * regionAlignment;
+    _region = 0;
+    glBufferData(GL_ARRAY_BUFFER, _regionSize * streamRegionCount, NULL, GL_STREAM_DRAW);
+    _stats.reallocations++;
+}
+
+void* StreamBuffer::Map(size_t size, size_t& offset) {
+    glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+    _mappedSize = size;
+    if (!_stats.orphaning) {
+        if (size > _regionSize) {
+            Reallocate(size);
+        }
+        WaitRegion(_region);
+        offset = _region * _regionSize;
+        if (size == 0) {
+            return nullptr;
+        }
+        // the fence already guarantees the gpu is done with this range
+        void* target = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (target != nullptr) {
+            return target;
+        }
+        _stats.orphaning = true;
+    }
+    offset = 0;
+    _staging.resize(size);
+    return _staging.data();
+}
+
+void StreamBuffer::Unmap() {
+    if (_mappedSize == 0) {
+        return;
+    }
+    if (_stats.orphaning) {
+        // fresh storage every time, the driver handles the syncing
+        glBufferData(GL_ARRAY_BUFFER, _mappedSize, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, _mappedSize, _staging.data());
+    }
+    else {
+        // false means the storage was lost (display mode change), the region is garbage for one frame
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    _mappedSize = 0;
+}
+
+size_t StreamBuffer::Write(const void* data, size_t size) {
+    size_t offset;
+    void* target = Map(size, offset);
+    if (size > 0) {
+        memcpy(target, data, size);
+    }
+    Unmap();
+    return offset;
+}
+
+void StreamBuffer::Fence() {
+    if (_stats.orphaning || _regionSize == 0) {
+        return;
+    }
+    if (_fences[_region] != nullptr) {
+        glDeleteSync((GLsync)_fences[_region]);
+    }
+    _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _region = (_region + 1) % streamRegionCount;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef _STREAMBUFFER_HPP
+#define _STREAMBUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+
+// regions written while the gpu may still read the others, 3 frames in flight
+constexpr int streamRegionCount = 3;
+
+// upload counters since creation
+struct StreamStats {
+    // storage (re)allocations, only when a frame outgrows a region
+    size_t reallocations = 0;
+    // writes that had to wait for the gpu to finish with their region
+    size_t stalls = 0;
+    // true once mapping failed and every write orphans the buffer instead
+    bool orphaning = false;
+};
+
+// array buffer for data rewritten every frame, split into a ring of regions
+// each write maps the next region unsynchronized and a fence per region keeps it from being overwritten
+// while the gpu still reads it, so the driver never reallocates or blocks on the whole buffer
+// gl 3.3 has no persistent mapping, mapping a range per write is the closest it gets
+// needs a current context for everything
+class StreamBuffer {
+    unsigned int _buffer;
+    size_t _regionSize;
+    int _region;
+    // GLsync per region, null while the region is free
+    void* _fences[streamRegionCount];
+    StreamStats _stats;
+    // bytes handed out by Map, staging is used instead of a mapping while orphaning
+    size_t _mappedSize;
+    std::vector<unsigned char> _staging;
+
+    // waits for the gpu to finish reading region
+    void WaitRegion(int region);
+    // drops the fences and gives the buffer new storage of at least size per region
+    void Reallocate(size_t size);
+public:
+    StreamBuffer();
+
+    // creates the gl buffer
+    int Create();
+
+    unsigned int GetBuffer() const;
+    StreamStats GetStats() const;
+
+    // returns memory for size bytes of the next region to be written in place, offset gets its offset in the buffer
+    // leaves the buffer bound to GL_ARRAY_BUFFER, every Map needs an Unmap before drawing
+    void* Map(size_t size, size_t& offset);
+    void Unmap();
+    // copies size bytes to the next region, returns its offset in the buffer
+    size_t Write(const void* data, size_t size);
+    // call after the last draw reading the written region, it is reused streamRegionCount writes later
+    void Fence();
+};
+
+#endif
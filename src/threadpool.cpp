@@ -0,0 +1,139 @@
+#include "threadpool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "definitions.hpp"
+
+// yields a little before sleeping, jobs come in quick succession within a tick
+constexpr int spinIterations = 256;
+
+
+// private
+
+void ThreadPool::WorkerLoop(int threadIndex, unsigned long long seen) {
+    while (true) {
+        for (int i = 0; i < spinIterations && _generation.load(std::memory_order_acquire) == seen; i++) {
+            std::this_thread::yield();
+        }
+        if (_generation.load(std::memory_order_acquire) == seen) {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _start.wait(lock, [&] { return _stopping || _generation.load() != seen; });
+        }
+        if (_stopping) {
+            return;
+        }
+        seen = _generation.load(std::memory_order_acquire);
+        RunChunk(threadIndex);
+        if (_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::RunChunk(int threadIndex) {
+    if (threadIndex >= _jobThreads) {
+        return;
+    }
+    size_t begin = _jobCount * threadIndex / _jobThreads;
+    size_t end = _jobCount * (threadIndex + 1) / _jobThreads;
+    if (begin < end) {
+        (*_job)(threadIndex, begin, end);
+    }
+}
+
+void ThreadPool::StartWorkers() {
+    _stopping = false;
+    for (int i = 1; i < _threadCount; i++) {
+        _workers.emplace_back(&ThreadPool::WorkerLoop, this, i, _generation.load());
+    }
+}
+
+void ThreadPool::StopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stopping = true;
+    }
+    _start.notify_all();
+    for (auto& worker: _workers) {
+        worker.join();
+    }
+    _workers.clear();
+}
+
+
+// public
+
+int ThreadPool::HardwareThreads() {
+    int count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+ThreadPool::ThreadPool(int threadCount) {
+    _generation = 0;
+    _remaining = 0;
+    _stopping = false;
+    _job = nullptr;
+    _jobCount = 0;
+    _jobThreads = 1;
+    _threadCount = threadCount > 0 ? threadCount : 1;
+    StartWorkers();
+}
+
+ThreadPool::~ThreadPool() {
+    StopWorkers();
+}
+
+int ThreadPool::GetThreadCount() const {
+    return _threadCount;
+}
+
+int ThreadPool::SetThreadCount(int threadCount) {
+    if (threadCount < 1) {
+        return FAIL;
+    }
+    if (threadCount == _threadCount) {
+        return SUCCESS;
+    }
+    StopWorkers();
+    _threadCount = threadCount;
+    StartWorkers();
+    return SUCCESS;
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(int, size_t, size_t)>& job, size_t minChunk) {
+    size_t threads = count / (minChunk > 0 ? minChunk : 1);
+    if (threads > (size_t)_threadCount) {
+        threads = _threadCount;
+    }
+    if (threads < 2) {
+        if (count > 0) {
+            job(0, 0, count);
+        }
+        return;
+    }
+    _job = &job;
+    _jobCount = count;
+    _jobThreads = threads;
+    _remaining.store(_threadCount - 1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _generation.fetch_add(1, std::memory_order_release);
+    }
+    _start.notify_all();
+
+    RunChunk(0);
+
+    for (int i = 0; i < spinIterations && _remaining.load(std::memory_order_acquire) > 0; i++) {
+        std::this_thread::yield();
+    }
+    if (_remaining.load(std::memory_order_acquire) > 0) {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _done.wait(lock, [&] { return _remaining.load() == 0; });
+    }
+}
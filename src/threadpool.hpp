@@ -0,0 +1,56 @@
+#pragma once
+#ifndef _THREADPOOL_HPP
+#define _THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// minChunk for loops over force targets, below this many per thread waking workers costs more than it saves
+constexpr size_t minTargetsPerThread = 32;
+
+// persistent workers for splitting a loop over the cores
+// the calling thread takes part as thread 0, so one thread means no workers
+class ThreadPool {
+    std::vector<std::thread> _workers;
+    std::mutex _mtx;
+    std::condition_variable _start;
+    std::condition_variable _done;
+
+    // bumped for every job, workers wait for it to change
+    std::atomic<unsigned long long> _generation;
+    std::atomic<int> _remaining;
+    std::atomic<bool> _stopping;
+
+    const std::function<void(int, size_t, size_t)>* _job;
+    size_t _jobCount;
+    int _jobThreads;
+
+    int _threadCount;
+
+    void WorkerLoop(int threadIndex, unsigned long long seen);
+    void RunChunk(int threadIndex);
+    void StartWorkers();
+    void StopWorkers();
+public:
+    static int HardwareThreads();
+
+    ThreadPool(int threadCount = 1);
+    ~ThreadPool();
+
+    int GetThreadCount() const;
+    // must not be called during a ParallelFor
+    int SetThreadCount(int threadCount);
+
+    // splits [0, count) into one contiguous chunk per thread and runs job(threadIndex, begin, end) on each
+    // uses fewer threads if chunks would be smaller than minChunk
+    // chunk boundaries only depend on count, minChunk and the thread count
+    // blocks until every chunk is done
+    void ParallelFor(size_t count, const std::function<void(int, size_t, size_t)>& job, size_t minChunk = 1);
+};
+
+#endif
@@ -1,13 +1,29 @@
 #include "time.hpp"
 
+#include <atomic>
 #include <chrono>
 
 #include "definitions.hpp"
 
+#ifdef __linux__
+    #include <errno.h>
+    #include <time.h>
+#endif
 #ifdef _WIN32
     #include <windows.h>
 #endif
 
+// a loop further behind than this drops the backlog and starts a new schedule
+constexpr unsigned long long maxCatchUpTicks = 4;
+
+// s, the timer wakeup error that gets absorbed by spinning
+#ifdef _WIN32
+    constexpr double defaultSpinMargin = 0.002;
+#else
+    constexpr double defaultSpinMargin = 0.0001;
+#endif
+constexpr double maxSpinMargin = 0.01;
+
 // credit to https://gist.github.com/Youka/4153f12cf2e17a77314c
 bool nanosleepWin(long long microseconds) {
     #ifdef _WIN32
@@ -36,33 +52,66 @@ bool nanosleepWin(long long microseconds) {
 }
 
 
-// public
+// private
 
-void Time::sleep(double seconds) {
-    while (seconds > 0.002) { // takes "up to" 2 ms when sleeping for 1 ms
-        auto start = std::chrono::high_resolution_clock::now();
+std::chrono::steady_clock::time_point Time::Deadline(unsigned long long tick) const {
+    // computed from the anchor every time, so rounding of the period never adds up
+    return _anchor + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(tick * _period));
+}
+
+void Time::RecordJitter(double jitter) {
+    // single writer, plain load / store pairs are enough
+    _jitterSamples.fetch_add(1, std::memory_order_relaxed);
+    _jitterSum.store(_jitterSum.load(std::memory_order_relaxed) + jitter, std::memory_order_relaxed);
+    if (jitter > _jitterMax.load(std::memory_order_relaxed)) {
+        _jitterMax.store(jitter, std::memory_order_relaxed);
+    }
+}
 
+
+// public
+
+void Time::SleepUntil(std::chrono::steady_clock::time_point deadline, double spinMargin) {
+    auto wake = deadline - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(spinMargin));
+    if (wake > std::chrono::steady_clock::now()) {
         #ifdef __linux__
-            struct timespec t = {0, 950 * 1000}, r;
-            nanosleep(&t, &r); // sleep for ~ 1 ms
+            // steady_clock is CLOCK_MONOTONIC, so its time points are valid absolute timer values
+            long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wake.time_since_epoch()).count();
+            struct timespec t = { (time_t)(ns / 1000000000), (long)(ns % 1000000000) };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, nullptr) == EINTR);
         #endif
         #ifdef _WIN32
-            nanosleepWin(1000); // sleep ~ 1 ms (1000 us), but it varies up a bit
+            auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(wake - std::chrono::steady_clock::now());
+            if (remaining.count() > 0) {
+                nanosleepWin(remaining.count());
+            }
         #endif
-
-        auto end = std::chrono::high_resolution_clock::now();
-        double observed = (end - start).count() / 1e9;
-        seconds -= observed;
     }
     // spin lock
-    auto start = std::chrono::high_resolution_clock::now();
-    auto spinNs = int64_t(seconds * 1e9);
-    auto delay = std::chrono::nanoseconds(spinNs);
-    while (std::chrono::high_resolution_clock::now() - start < delay);
+    while (std::chrono::steady_clock::now() < deadline);
+}
+
+void Time::sleep(double seconds) {
+    SleepUntil(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(seconds)), defaultSpinMargin);
 }
 
 Time::Time() {
     _targetTickSpeed = 60;
+    _spinMargin = defaultSpinMargin;
+    _latePolicy = LatePolicy::catchUp;
+    _scheduledTicks = 0;
+    _period = 0.0;
+    _scheduled = false;
+    _pacedTicks = 0;
+    _lateTicks = 0;
+    _droppedTicks = 0;
+    _jitterSamples = 0;
+    _jitterSum = 0.0;
+    _jitterMax = 0.0;
+    _resetStats = false;
 }
 
 double Time::GetTickSpeed() const {
@@ -77,6 +126,41 @@ int Time::SetTickSpeed(double tickSpeed) {
     return SUCCESS;
 }
 
+double Time::GetSpinMargin() const {
+    return _spinMargin;
+}
+
+int Time::SetSpinMargin(double seconds) {
+    if (seconds < 0.0 || seconds > maxSpinMargin) {
+        return FAIL;
+    }
+    _spinMargin = seconds;
+    return SUCCESS;
+}
+
+LatePolicy Time::GetLatePolicy() const {
+    return _latePolicy;
+}
+
+void Time::SetLatePolicy(LatePolicy policy) {
+    _latePolicy = policy;
+}
+
+PacingStats Time::GetPacingStats() const {
+    PacingStats stats;
+    stats.ticks = _pacedTicks.load(std::memory_order_relaxed);
+    stats.late = _lateTicks.load(std::memory_order_relaxed);
+    stats.dropped = _droppedTicks.load(std::memory_order_relaxed);
+    unsigned long long samples = _jitterSamples.load(std::memory_order_relaxed);
+    stats.meanJitter = samples > 0 ? _jitterSum.load(std::memory_order_relaxed) / samples : 0.0;
+    stats.maxJitter = _jitterMax.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void Time::ResetPacingStats() {
+    _resetStats = true;
+}
+
 void Time::TickStart() {
     _tickStart = std::chrono::steady_clock::now();
 }
@@ -87,7 +171,52 @@ void Time::TickEnd() {
 
 void Time::TickEndAndSleep() {
     _tickEnd = std::chrono::steady_clock::now();
-    double tickDuration = (_tickEnd - _tickStart).count() / 1e9;
-    double totalDuration = (1.0 / _targetTickSpeed);
-    sleep(totalDuration - tickDuration);
+    if (_resetStats.exchange(false)) {
+        _pacedTicks = 0;
+        _lateTicks = 0;
+        _droppedTicks = 0;
+        _jitterSamples = 0;
+        _jitterSum = 0.0;
+        _jitterMax = 0.0;
+    }
+    _pacedTicks.fetch_add(1, std::memory_order_relaxed);
+
+    double period = 1.0 / _targetTickSpeed;
+    if (!_scheduled || period != _period) {
+        _anchor = _tickStart;
+        _scheduledTicks = 0;
+        _period = period;
+        _scheduled = true;
+    }
+    _scheduledTicks++;
+    auto deadline = Deadline(_scheduledTicks);
+
+    if (_tickEnd >= deadline) {
+        _lateTicks.fetch_add(1, std::memory_order_relaxed);
+        // whole periods missed on top of this one
+        unsigned long long behind = (unsigned long long)(std::chrono::duration<double>(_tickEnd - deadline).count() / _period);
+        if (_latePolicy == LatePolicy::drop) {
+            _scheduledTicks += behind + 1;
+            _droppedTicks.fetch_add(behind + 1, std::memory_order_relaxed);
+            deadline = Deadline(_scheduledTicks);
+        }
+        else if (behind >= maxCatchUpTicks) {
+            // too far behind to catch up, the next tick starts a new schedule
+            _droppedTicks.fetch_add(behind, std::memory_order_relaxed);
+            _anchor = _tickEnd;
+            _scheduledTicks = 0;
+            return;
+        }
+        else {
+            // the next tick starts right away
+            return;
+        }
+    }
+
+    SleepUntil(deadline, _spinMargin);
+    RecordJitter(std::chrono::duration<double>(std::chrono::steady_clock::now() - deadline).count());
+}
+
+void Time::Resync() {
+    _scheduled = false;
 }
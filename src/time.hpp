@@ -2,26 +2,75 @@
 #ifndef _TIME_HPP
 #define _TIME_HPP
 
+#include <atomic>
 #include <chrono>
 
+// what a paced loop does after a tick overran its deadline
+enum class LatePolicy {
+    catchUp, // keep the schedule, run the missed ticks back to back (up to maxCatchUpTicks)
+    drop     // skip the missed deadlines and wait for the next one
+};
+
+// wakeup lateness and schedule misses since the last reset
+struct PacingStats {
+    unsigned long long ticks = 0;
+    unsigned long long late = 0;    // ticks that ended after their deadline
+    unsigned long long dropped = 0; // deadlines skipped by drop or a resync
+    double meanJitter = 0.0;        // s, how late sleeps woke up
+    double maxJitter = 0.0;
+};
+
+// paces a loop on absolute deadlines: tick n is due at anchor + n / tickSpeed
+// the setters and stats may be used from any thread, the tick calls only from the paced one
 class Time {
-    double _targetTickSpeed;
+    std::atomic<double> _targetTickSpeed;
+    std::atomic<double> _spinMargin; // s
+    std::atomic<LatePolicy> _latePolicy;
+
     std::chrono::steady_clock::time_point _tickStart;
     std::chrono::steady_clock::time_point _tickEnd;
+    // schedule, restarted on a tick speed change or Resync
+    std::chrono::steady_clock::time_point _anchor;
+    unsigned long long _scheduledTicks;
+    double _period;
+    bool _scheduled;
+
+    std::atomic<unsigned long long> _pacedTicks;
+    std::atomic<unsigned long long> _lateTicks;
+    std::atomic<unsigned long long> _droppedTicks;
+    std::atomic<unsigned long long> _jitterSamples;
+    std::atomic<double> _jitterSum;
+    std::atomic<double> _jitterMax;
+    std::atomic<bool> _resetStats;
+
+    std::chrono::steady_clock::time_point Deadline(unsigned long long tick) const;
+    void RecordJitter(double jitter);
 public:
+    // sleeps until deadline, the last spinMargin seconds are spent spinning
+    static void SleepUntil(std::chrono::steady_clock::time_point deadline, double spinMargin);
     static void sleep(double seconds);
 
     Time();
 
     double GetTickSpeed() const;
     int SetTickSpeed(double tickSpeed);
+    double GetSpinMargin() const;
+    int SetSpinMargin(double seconds);
+    LatePolicy GetLatePolicy() const;
+    void SetLatePolicy(LatePolicy policy);
+
+    PacingStats GetPacingStats() const;
+    // applied by the paced thread at its next tick
+    void ResetPacingStats();
 
     // tracks beginning of a frame
     void TickStart();
     // tracks end of a frame
     void TickEnd();
-    // tracks end of a frame and sleeps to maintain framerate
-    void TickEndAndSleep();    
+    // tracks end of a frame and sleeps until the next deadline
+    void TickEndAndSleep();
+    // starts a new schedule at the next TickStart, for loops that were idle
+    void Resync();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,118 @@
+#pragma once
+#ifndef _TRAJECTORY_HPP
+#define _TRAJECTORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// trajectory files (version 1), native byte order (files from a machine with the other one are rejected by byteOrderMark):
+//   TrajectoryHeader
+//   chunks: TrajectoryChunkHeader, body table, then frameCount frames
+//   index: one TrajectoryIndexEntry per chunk, then TrajectoryFooter at the very end
+// a file without footer (crash) can still be read by walking the chunk headers
+//
+// every chunk starts from scratch, so a reader can decode it without the ones before
+// body table: per body the name (varint length + bytes), radius (double), luminosity, red, green, blue (floats)
+// frame: varint tick delta to the chunk's first tick, simulated time (double),
+//   then per recorded component (x, y, z, then xVel, yVel, zVel) one zigzag varint per body:
+//   the quantized value minus its prediction, which is 0 for the first frame,
+//   the previous value for the second and the linear extrapolation of the two previous ones after that
+constexpr uint32_t trajectoryVersion = 1;
+constexpr char trajectoryMagic[8] = { 'G', 'R', 'A', 'V', 'T', 'R', 'A', 'J' };
+constexpr char trajectoryChunkMagic[4] = { 'C', 'H', 'N', 'K' };
+constexpr char trajectoryIndexMagic[8] = { 'G', 'R', 'A', 'V', 'I', 'D', 'X', '1' };
+
+// recorded components, as bits
+enum TrajectoryField : uint32_t {
+    trajectoryPositions = 1,
+    trajectoryVelocities = 2
+};
+
+struct TrajectoryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t fields;
+    uint32_t decimation;
+    // units per quantization step
+    double positionQuantum;
+    double velocityQuantum;
+};
+
+struct TrajectoryChunkHeader {
+    char magic[4];
+    uint32_t frameCount;
+    uint64_t bodyCount;
+    uint64_t firstTick;
+    uint64_t lastTick;
+    double firstTime;
+    double lastTime;
+    // bytes of body table and frames that follow the header
+    uint64_t tableSize;
+    uint64_t framesSize;
+};
+
+struct TrajectoryIndexEntry {
+    uint64_t offset;
+    uint64_t firstTick;
+    double firstTime;
+    double lastTime;
+};
+
+struct TrajectoryFooter {
+    uint64_t indexOffset;
+    uint64_t chunkCount;
+    char magic[8];
+};
+
+// body attributes that only change with the bodies themselves, stored once per chunk
+struct TrajectoryBodyTable {
+    uint64_t version = 0; // BodyStore::Version() it was taken at
+    std::vector<std::string> names;
+    std::vector<double> radius;
+    std::vector<float> luminosity;
+    std::vector<float> red, green, blue;
+};
+
+inline int TrajectoryComponents(uint32_t fields) {
+    return ((fields & trajectoryPositions) ? 3 : 0) + ((fields & trajectoryVelocities) ? 3 : 0);
+}
+
+inline void WriteVarint(std::vector<unsigned char>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((unsigned char)value);
+}
+
+// small magnitudes of either sign get short codes
+inline void WriteZigzag(std::vector<unsigned char>& out, int64_t value) {
+    WriteVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+// returns false if the varint runs past end
+inline bool ReadVarint(const unsigned char*& data, const unsigned char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7) {
+        unsigned char byte = *data++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool ReadZigzag(const unsigned char*& data, const unsigned char* end, int64_t& value) {
+    uint64_t raw;
+    if (!ReadVarint(data, end, raw)) {
+        return false;
+    }
+    value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+    return true;
+}
+
+#endif
@@ -1,76 +1,139 @@
 #include "universe.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <thread>
 
 #include "body.hpp"
+#include "checkpoint.hpp"
 #include "definitions.hpp"
+#include "gravity.hpp"
+#include "profiler.hpp"
+#include "replay.hpp"
 #include "values.hpp"
 
-inline double CalculateGravitationalAcceleration(double mass, double distanceSquared, double cScaling) {
-    double distance = sqrt(distanceSquared);
-    double G2oc2Scaled = G2oc2 / (cScaling * cScaling); // 1 / c^2 -> 1 / cScaling^2
-    double relativity = 1.0 / sqrt(1.0 - (G2oc2Scaled * mass / distance));
-    return (G * mass / distanceSquared) * relativity;
-    // https://physics.stackexchange.com/questions/47379/what-is-the-weight-equation-through-general-relativity
-}
-
-inline int Accelerate(Body& obj1, const Body& obj2, double tickspeedFactor, double gravityScaling, double cScaling) {
-    double dx = obj2.x - obj1.x;
-    double dy = obj2.y - obj1.y;
-    double dz = obj2.z - obj1.z;
-    double distanceSquared = (dx * dx) + (dy * dy) + (dz * dz);
-    double distance = sqrt(distanceSquared);
-    double acceleration = CalculateGravitationalAcceleration(obj2.mass, distanceSquared, cScaling) * gravityScaling;
-    double accelerationFraction = tickspeedFactor * acceleration / distance;
-    // TODO: adjust acceleration/velocity based on relativity
-    if (fabs(distance) > 1e-18) {
-        obj1.xVel += accelerationFraction * dx;
-        obj1.yVel += accelerationFraction * dy;
-        obj1.zVel += accelerationFraction * dz;
-    }
-    return SUCCESS;
+// bodies compared against an exact sum by EstimateSolverError
+constexpr size_t errorSamples = 64;
+// render thread plus one spare
+constexpr int snapshotReaders = 2;
+// s, how long callers wait for the physics thread to apply a change
+constexpr double commandTimeout = 5.0;
+// s, checkpoints of millions of bodies take a while to write
+constexpr double checkpointTimeout = 600.0;
+// a waiting caller can push its next command while a batch is applied, this keeps ticks going
+constexpr size_t maxCommandsPerBatch = 256;
+
+
+// 
+
+Universe::Universe() : _pool(ThreadPool::HardwareThreads()), _snapshots(snapshotReaders) {
+    _queueCommands = false;
+    _bodiesChanged = false;
+    _solver = &_directSolver;
+    _integrator = &_eulerIntegrator;
+    _tickSpeed = 60;
+    _timeScaling = 1;
+    _gravityScaling = 1;
+    _cScaling = 1;
+    _paused = false;
+    _tick = 0;
+    _simulatedTime = 0.0;
+    _snapshotStale = true;
+}
+
+
+// 
+
+void Universe::InvalidateAccelerations() {
+    _integrator.load()->Reset();
+    _snapshotStale = true;
 }
 
-inline bool CheckCollision(const Body& obj1, const Body& obj2) {
-    double dx = obj2.x - obj1.x;
-    double dy = obj2.y - obj1.y;
-    double dz = obj2.z - obj1.z;
-    double distance = sqrt((dx * dx) + (dy * dy) + (dz * dz));
-    if ((obj1.radius + obj2.radius) >= distance) {
-        return true;
+void Universe::Publish() {
+    // nobody reads them in headless runs
+    if (!_snapshotStale || !_snapshots.HasReaders()) {
+        return;
     }
-    return false;
+    _snapshots.WriteBuffer().Fill(_bodies, _tick, _simulatedTime);
+    _snapshots.Publish();
+    _snapshotStale = false;
 }
 
-inline bool CheckCollision(const Body& obj1, const Body& obj2, double distanceSquared) {
-    double distance = sqrt(distanceSquared);
-    if ((obj1.radius + obj2.radius) >= distance) {
-        return true;
+std::future<int> Universe::Submit(const std::function<int()>& run) const {
+    Command command;
+    command.run = run;
+    std::future<int> done = command.done.get_future();
+    bool queued = _queueCommands.load(std::memory_order_acquire);
+    if (queued && std::this_thread::get_id() != _commandThread.load(std::memory_order_relaxed)) {
+        _commands.Push(std::move(command));
+        if (_wakeHandler) {
+            _wakeHandler();
+        }
+    }
+    else {
+        command.done.set_value(run());
     }
-    return false;
+    return done;
 }
 
+int Universe::Wait(std::future<int>& done) const {
+    return Wait(done, commandTimeout);
+}
 
-// 
+int Universe::Wait(std::future<int>& done, double timeout) const {
+    if (done.wait_for(std::chrono::duration<double>(timeout)) != std::future_status::ready) {
+        std::cout << "physics thread busy, the command stays queued and runs later\n";
+        return QUEUED;
+    }
+    return done.get();
+}
 
-Universe::Universe() {
-    _tickSpeed = 60;
-    _timeScaling = 1;
-    _gravityScaling = 1;
-    _cScaling = 1;
-    _paused = false;
+int Universe::Execute(const std::function<int()>& run) {
+    std::future<int> done = Submit(run);
+    return Wait(done);
+}
+
+int Universe::WaitForAnswer(std::future<int>& done) const {
+    if (done.wait_for(std::chrono::duration<double>(commandTimeout)) != std::future_status::ready) {
+        std::cout << "physics thread busy, no answer\n";
+        return QUEUED;
+    }
+    return done.get();
 }
 
 
 // 
 
-const std::map<std::string, Body>& Universe::GetBodies() const {
+const BodyStore& Universe::GetBodies() const {
     return _bodies;
 }
 
-std::map<std::string, Body>& Universe::GetBodiesMut() {
-    return _bodies;
+int Universe::CopyBodies(BodyStore& bodies) const {
+    std::shared_ptr<BodyStore> copy = Query<std::shared_ptr<BodyStore>>([this]() {
+        return std::make_shared<BodyStore>(_bodies);
+    }, nullptr);
+    if (copy == nullptr) {
+        return FAIL;
+    }
+    bodies = *copy;
+    return SUCCESS;
+}
+
+int Universe::GetBody(const std::string& name, Body& body) const {
+    std::shared_ptr<Body> found = Query<std::shared_ptr<Body>>([this, name]() {
+        size_t index = _bodies.IndexOf(name);
+        return index == BodyStore::npos ? nullptr : std::make_shared<Body>(_bodies.GetBody(index));
+    }, nullptr);
+    if (found == nullptr) {
+        return FAIL;
+    }
+    body = *found;
+    return SUCCESS;
 }
 
 double Universe::GetTickSpeed() const {
@@ -89,126 +152,526 @@ double Universe::GetcScaling() const {
     return _cScaling;
 }
 
+int Universe::GetThreadCount() const {
+    return Query<int>([this]() { return _pool.GetThreadCount(); }, FAIL);
+}
+
+const char* Universe::GetSolver() const {
+    return _solver.load()->GetName();
+}
+
+double Universe::GetOpeningAngle() const {
+    return Query<double>([this]() { return _barnesHutSolver.GetOpeningAngle(); }, FAIL);
+}
+
+int Universe::GetFmmOrder() const {
+    return Query<int>([this]() { return _fmmSolver.GetOrder(); }, FAIL);
+}
+
+double Universe::GetFmmOpeningAngle() const {
+    return Query<double>([this]() { return _fmmSolver.GetOpeningAngle(); }, FAIL);
+}
+
+const char* Universe::GetIntegrator() const {
+    return _integrator.load()->GetName();
+}
+
+int Universe::GetBlockLevels() const {
+    return Query<int>([this]() { return _blockIntegrator.GetMaxLevel(); }, FAIL);
+}
+
+long long Universe::GetBlockEvaluations() const {
+    return Query<long long>([this]() { return (long long)_blockIntegrator.GetEvaluations(); }, FAIL);
+}
+
+std::string Universe::GetCollisions() const {
+    return Query<std::string>([this]() { return std::string(_collisions.GetResponse()); }, "");
+}
+
+long long Universe::GetLastContacts() const {
+    return Query<long long>([this]() { return (long long)_collisions.GetLastContacts(); }, FAIL);
+}
+
+int Universe::GetConservation(ConservationStats& stats) const {
+    std::shared_ptr<ConservationStats> found = Query<std::shared_ptr<ConservationStats>>([this]() {
+        return std::make_shared<ConservationStats>(_conservation.GetStats());
+    }, nullptr);
+    if (found == nullptr) {
+        return FAIL;
+    }
+    stats = *found;
+    return SUCCESS;
+}
+
+int Universe::GetEnergyInterval() const {
+    return Query<int>([this]() { return _conservation.GetEnergyInterval(); }, FAIL);
+}
+
+int Universe::GetRecording(RecorderStats& stats) const {
+    std::shared_ptr<RecorderStats> found = Query<std::shared_ptr<RecorderStats>>([this]() {
+        return std::make_shared<RecorderStats>(_recorder.GetStats());
+    }, nullptr);
+    if (found == nullptr) {
+        return FAIL;
+    }
+    stats = *found;
+    return SUCCESS;
+}
+
+int Universe::GetReplay(ReplayStats& stats) const {
+    std::shared_ptr<ReplayStats> found = Query<std::shared_ptr<ReplayStats>>([this]() {
+        return std::make_shared<ReplayStats>(_replay != nullptr ? _replay->GetStats() : ReplayStats());
+    }, nullptr);
+    if (found == nullptr) {
+        return FAIL;
+    }
+    stats = *found;
+    return SUCCESS;
+}
+
+int Universe::EstimateSolverError(SolverError& error) {
+    std::shared_ptr<SolverError> found = Query<std::shared_ptr<SolverError>>([this]() {
+        GravityParams params = { _gravityScaling, _cScaling };
+        return std::make_shared<SolverError>(::EstimateSolverError(*_solver.load(), _bodies, params, _pool, errorSamples));
+    }, nullptr);
+    if (found == nullptr) {
+        return FAIL;
+    }
+    error = *found;
+    return SUCCESS;
+}
+
 bool Universe::IsPaused() const {
     return _paused;
 }
 
+unsigned long long Universe::GetTick() const {
+    return _tick;
+}
+
+int Universe::RegisterSnapshotReader() const {
+    return _snapshots.RegisterReader();
+}
+
+const Snapshot* Universe::AcquireSnapshot(int reader) const {
+    return _snapshots.Acquire(reader);
+}
+
+void Universe::ReleaseSnapshot(int reader) const {
+    _snapshots.Release(reader);
+}
+
 
 // 
 
+void Universe::UseCommandQueue() {
+    _queueCommands.store(true, std::memory_order_release);
+}
+
+void Universe::SetWakeHandler(const std::function<void()>& wake) {
+    _wakeHandler = wake;
+}
+
 int Universe::AddBody(const std::string& name, const Body& body) {
     if (name == "") {
         std::cout << "Name must not be empty\n";
         return FAIL;
     }
-    _mtx.lock();
-    _bodies.emplace(name, body);
-    _mtx.unlock();
-    std::cout << "Added body: " << name << "\n";
-    return SUCCESS;
+    Body named = body;
+    named.name = name;
+    return Execute([this, named]() {
+        if (_bodies.Add(named) == BodyStore::invalidHandle) {
+            std::cout << "Body already exists: " << named.name << "\n";
+            return FAIL;
+        }
+        _bodiesChanged = true;
+        _conservation.Reset();
+        std::cout << "Added body: " << named.name << "\n";
+        return SUCCESS;
+    });
 }
 
 int Universe::RemoveBody(const std::string &name) {
-    _mtx.lock();
-    if (_bodies.find(name) == _bodies.end()) {
-        _mtx.unlock();
-        return FAIL;
-    }
-    _bodies.erase(name);
-    _mtx.unlock();
-    return SUCCESS;
+    return Execute([this, name]() {
+        if (_bodies.Remove(_bodies.Find(name)) <= FAIL) {
+            return FAIL;
+        }
+        _bodiesChanged = true;
+        _conservation.Reset();
+        return SUCCESS;
+    });
 }
 
 int Universe::ClearBodies() {
-    _mtx.lock();
-    _bodies.clear();
-    _mtx.unlock();
-    return SUCCESS;
+    return Execute([this]() {
+        _bodies.Clear();
+        _bodiesChanged = true;
+        _conservation.Reset();
+        return SUCCESS;
+    });
+}
+
+int Universe::UpdateBody(const std::string& name, const std::function<void(Body&)>& update) {
+    return Execute([this, name, update]() {
+        size_t index = _bodies.IndexOf(name);
+        if (index == BodyStore::npos) {
+            return FAIL;
+        }
+        Body body = _bodies.GetBody(index);
+        update(body);
+        _bodies.SetBody(index, body);
+        _bodiesChanged = true;
+        _conservation.Reset();
+        return SUCCESS;
+    });
+}
+
+int Universe::SaveCheckpoint(const std::string& path) const {
+    // written straight from the live store, a copy of millions of bodies would cost as much
+    std::future<int> done = Submit([this, path]() {
+        CheckpointScalars scalars;
+        scalars.tick = _tick;
+        scalars.simulatedTime = _simulatedTime;
+        scalars.tickSpeed = _tickSpeed;
+        scalars.timeScaling = _timeScaling;
+        scalars.gravityScaling = _gravityScaling;
+        scalars.cScaling = _cScaling;
+        return ::SaveCheckpoint(path, _bodies, scalars);
+    });
+    return Wait(done, checkpointTimeout);
+}
+
+int Universe::LoadCheckpoint(const std::string& path) {
+    std::shared_ptr<BodyStore> bodies = std::make_shared<BodyStore>();
+    CheckpointScalars scalars;
+    if (::LoadCheckpoint(path, *bodies, scalars) <= FAIL) {
+        return FAIL;
+    }
+    return Execute([this, bodies, scalars]() {
+        _bodies = std::move(*bodies);
+        time.SetTickSpeed(scalars.tickSpeed);
+        _tickSpeed = scalars.tickSpeed;
+        _timeScaling = scalars.timeScaling;
+        _gravityScaling = scalars.gravityScaling;
+        _cScaling = scalars.cScaling;
+        _tick = scalars.tick;
+        _simulatedTime = scalars.simulatedTime;
+        _replay = nullptr;
+        _bodiesChanged = true;
+        _conservation.Reset();
+        return SUCCESS;
+    });
 }
 
 int Universe::SetTickSpeed(double tickSpeed) {
     if (tickSpeed <= 0) {
         return FAIL;
     }
-    _mtx.lock();
-    time.SetTickSpeed(tickSpeed);
-    _tickSpeed = tickSpeed;
-    _mtx.unlock();
-    return SUCCESS;
+    // the physics thread paces itself with time
+    return Execute([this, tickSpeed]() {
+        time.SetTickSpeed(tickSpeed);
+        _tickSpeed = tickSpeed;
+        return SUCCESS;
+    });
 }
 
 int Universe::SetTimeScaling(double timeScaling) {
     if (timeScaling <= 0) {
         return FAIL;
     }
-    _mtx.lock();
+    // read once at the start of each tick
     _timeScaling = timeScaling;
-    _mtx.unlock();
     return SUCCESS;
 }
 
 int Universe::SetGravityScaling(double gravityScaling) {
-    _mtx.lock();
-    _gravityScaling = gravityScaling;
-    _mtx.unlock();
-    return SUCCESS;
+    return Execute([this, gravityScaling]() {
+        _gravityScaling = gravityScaling;
+        _bodiesChanged = true;
+        _conservation.Reset();
+        return SUCCESS;
+    });
 }
 
 int Universe::SetcScaling(double cScaling) {
     if (cScaling <= 0) {
         return FAIL;
     }
-    _mtx.lock();
-    _cScaling = cScaling;
-    _mtx.unlock();
-    return SUCCESS;
+    return Execute([this, cScaling]() {
+        _cScaling = cScaling;
+        _bodiesChanged = true;
+        _conservation.Reset();
+        return SUCCESS;
+    });
 }
 
-int Universe::Pause() {
-    _mtx.lock();
-    if (_paused) {
-        return false;
+int Universe::SetThreadCount(int threadCount) {
+    if (threadCount < 1) {
+        return FAIL;
+    }
+    return Execute([this, threadCount]() {
+        return _pool.SetThreadCount(threadCount);
+    });
+}
+
+int Universe::SetSolver(const std::string& name) {
+    Solver* solver;
+    if (name == _directSolver.GetName()) {
+        solver = &_directSolver;
+    }
+    else if (name == _symmetricSolver.GetName()) {
+        solver = &_symmetricSolver;
+    }
+    else if (name == _barnesHutSolver.GetName()) {
+        solver = &_barnesHutSolver;
+    }
+    else if (name == _fmmSolver.GetName()) {
+        solver = &_fmmSolver;
+    }
+    else {
+        return FAIL;
+    }
+    return Execute([this, solver]() {
+        _solver = solver;
+        _bodiesChanged = true;
+        return SUCCESS;
+    });
+}
+
+int Universe::SetIntegrator(const std::string& name) {
+    Integrator* integrator;
+    if (name == _eulerIntegrator.GetName()) {
+        integrator = &_eulerIntegrator;
+    }
+    else if (name == _leapfrogIntegrator.GetName()) {
+        integrator = &_leapfrogIntegrator;
+    }
+    else if (name == _yoshidaIntegrator.GetName()) {
+        integrator = &_yoshidaIntegrator;
+    }
+    else if (name == _forestRuthIntegrator.GetName()) {
+        integrator = &_forestRuthIntegrator;
+    }
+    else if (name == _blockIntegrator.GetName()) {
+        integrator = &_blockIntegrator;
+    }
+    else {
+        return FAIL;
+    }
+    return Execute([this, integrator]() {
+        _integrator = integrator;
+        _bodiesChanged = true;
+        return SUCCESS;
+    });
+}
+
+int Universe::SetBlockLevels(int levels) {
+    return Execute([this, levels]() {
+        return _blockIntegrator.SetMaxLevel(levels);
+    });
+}
+
+int Universe::SetCollisions(const std::string& response) {
+    return Execute([this, response]() {
+        return _collisions.SetResponse(response);
+    });
+}
+
+int Universe::SetEnergyInterval(int ticks) {
+    return Execute([this, ticks]() {
+        return _conservation.SetEnergyInterval(ticks);
+    });
+}
+
+int Universe::StartRecording(const RecorderOptions& options) {
+    return Execute([this, options]() {
+        return _recorder.Start(options);
+    });
+}
+
+int Universe::StopRecording() {
+    // the writer may still hold a full ring of frames
+    std::future<int> done = Submit([this]() {
+        return _recorder.Stop();
+    });
+    return Wait(done, checkpointTimeout);
+}
+
+int Universe::OpenReplay(const std::string& path) {
+    std::shared_ptr<Replay> replay = std::make_shared<Replay>();
+    if (replay->Open(path) <= FAIL) {
+        return FAIL;
     }
-    _paused = true;
-    _mtx.unlock();
-    return true;
+    // decoded off the physics thread into a store of its own, a damaged file leaves the universe as it was
+    std::shared_ptr<BodyStore> bodies = std::make_shared<BodyStore>();
+    if (replay->Seek(replay->GetFirstTime(), *bodies) <= FAIL) {
+        std::cout << "cannot decode the first frame\n";
+        return FAIL;
+    }
+    return Execute([this, replay, bodies]() {
+        _bodies = std::move(*bodies);
+        _replay = replay;
+        _tick = replay->GetTick();
+        _simulatedTime = replay->GetTime();
+        _bodiesChanged = true;
+        _conservation.Reset();
+        return SUCCESS;
+    });
+}
+
+int Universe::SeekReplay(double time) {
+    return Execute([this, time]() {
+        if (_replay == nullptr) {
+            return FAIL;
+        }
+        // like LoadCheckpoint, the bodies are only replaced once the whole frame decoded
+        BodyStore bodies;
+        if (_replay->Seek(time, bodies) <= FAIL) {
+            return FAIL;
+        }
+        _bodies = std::move(bodies);
+        _tick = _replay->GetTick();
+        // playback continues from the requested time, not from the frame before it
+        _simulatedTime = std::clamp(time, _replay->GetFirstTime(), _replay->GetLastTime());
+        _bodiesChanged = true;
+        return SUCCESS;
+    });
+}
+
+int Universe::CloseReplay() {
+    return Execute([this]() {
+        if (_replay == nullptr) {
+            return FAIL;
+        }
+        _replay = nullptr;
+        _bodiesChanged = true;
+        _conservation.Reset();
+        return SUCCESS;
+    });
+}
+
+int Universe::SetOpeningAngle(double theta) {
+    return Execute([this, theta]() {
+        _bodiesChanged = true;
+        return _barnesHutSolver.SetOpeningAngle(theta);
+    });
+}
+
+int Universe::SetFmmOrder(int order) {
+    return Execute([this, order]() {
+        _bodiesChanged = true;
+        return _fmmSolver.SetOrder(order);
+    });
+}
+
+int Universe::SetFmmOpeningAngle(double theta) {
+    return Execute([this, theta]() {
+        _bodiesChanged = true;
+        return _fmmSolver.SetOpeningAngle(theta);
+    });
+}
+
+int Universe::Pause() {
+    // true if this call paused it
+    return !_paused.exchange(true);
 }
 
 int Universe::Unpause() {
-    _mtx.lock();
-    if (!_paused) {
-        return false;
+    bool wasPaused = _paused.exchange(false);
+    if (wasPaused && _wakeHandler) {
+        _wakeHandler();
     }
-    _paused = false;
-    _mtx.unlock();
-    return true;
+    return wasPaused;
 }
 
 int Universe::CalculateTick() {
-    _mtx.lock();
-    double tickspeedFactor = _timeScaling * 1.0 / _tickSpeed;
-    // move positions
-    for (auto& [name, body]: _bodies) {
-        body.x += body.xVel * tickspeedFactor;
-        body.y += body.yVel * tickspeedFactor;
-        body.z += body.zVel * tickspeedFactor;
-        body.theta += body.thetaVel * tickspeedFactor;
-        body.phi += body.phiVel * tickspeedFactor;
-        body.psi += body.psiVel * tickspeedFactor;
-        body.theta = fmod(body.theta, 360.0);
-        body.phi = fmod(body.phi, 360.0);
-        body.psi = fmod(body.psi, 360.0);
-    }
-    // calculate accelerations
-    for (auto& [name1, body1]: _bodies) {
-        for (auto& [name2, body2]: _bodies) {
-            // if the same body, skip
-            if (name1 == name2) {
-                continue;
-            }
-            Accelerate(body1, body2, tickspeedFactor, _gravityScaling, _cScaling);
-        }
+    ScopedTimer tickTimer(Phase::tick);
+    {
+        ScopedTimer timer(Phase::commands);
+        ProcessCommands();
+    }
+    if (_replay != nullptr) {
+        return ReplayTick();
     }
-    _mtx.unlock();
+    double tickspeedFactor = _timeScaling / _tickSpeed;
+    ForceContext forces = { _solver, { _gravityScaling, _cScaling }, &_pool };
+    int result;
+    {
+        ScopedTimer timer(Phase::integrate);
+        result = _integrator.load()->Step(_bodies, tickspeedFactor, forces);
+    }
+    bool modified;
+    {
+        ScopedTimer timer(Phase::collisions);
+        _collisions.Resolve(_bodies, modified);
+    }
+    if (modified) {
+        InvalidateAccelerations();
+        _conservation.Reset();
+    }
+    _tick++;
+    _simulatedTime += tickspeedFactor;
+    {
+        ScopedTimer timer(Phase::conservation);
+        _conservation.Update(_bodies, _tick, *forces.solver, forces.params, _pool);
+    }
+    _snapshotStale = true;
+    {
+        ScopedTimer timer(Phase::publish);
+        Publish();
+    }
+    if (_recorder.IsRecording()) {
+        ScopedTimer timer(Phase::record);
+        _recorder.Capture(_bodies, _tick, _simulatedTime);
+    }
+    return result;
+}
+
+int Universe::ReplayTick() {
+    _simulatedTime += _timeScaling / _tickSpeed;
+    int frames;
+    {
+        ScopedTimer timer(Phase::replay);
+        frames = _replay->Advance(_simulatedTime, _bodies);
+    }
+    if (frames <= FAIL) {
+        std::cout << "replay: damaged frame after tick " << _tick << ", pausing\n";
+        _paused = true;
+        return FAIL;
+    }
+    _tick = _replay->GetTick();
+    if (_replay->AtEnd() && _simulatedTime >= _replay->GetLastTime()) {
+        _simulatedTime = _replay->GetLastTime();
+        _paused = true;
+    }
+    if (frames > 0) {
+        _snapshotStale = true;
+    }
+    {
+        ScopedTimer timer(Phase::publish);
+        Publish();
+    }
+    if (_recorder.IsRecording() && frames > 0) {
+        ScopedTimer timer(Phase::record);
+        _recorder.Capture(_bodies, _tick, _simulatedTime);
+    }
+    return SUCCESS;
+}
+
+int Universe::ProcessCommands() {
+    _commandThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    Command command;
+    for (size_t i = 0; i < maxCommandsPerBatch && _commands.Pop(command); i++) {
+        command.done.set_value(command.run());
+    }
+    if (_bodiesChanged) {
+        InvalidateAccelerations();
+        _bodiesChanged = false;
+    }
+    return SUCCESS;
+}
+
+int Universe::PublishSnapshot() {
+    Publish();
     return SUCCESS;
 }
@@ -2,24 +2,120 @@
 #ifndef _UNIVERSE_HPP
 #define _UNIVERSE_HPP
 
-#include <map>
-#include <mutex>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
 #include <string>
+#include <thread>
 
+#include "barneshut.hpp"
 #include "body.hpp"
+#include "bodystore.hpp"
+#include "collision.hpp"
+#include "checkpoint.hpp"
+#include "commandqueue.hpp"
+#include "conservation.hpp"
 #include "definitions.hpp"
+#include "fmm.hpp"
+#include "integrator.hpp"
+#include "recorder.hpp"
+#include "replay.hpp"
+#include "snapshot.hpp"
+#include "solver.hpp"
+#include "threadpool.hpp"
 #include "time.hpp"
 
 class Universe {
-    std::map<std::string, Body> _bodies;
-    std::mutex _mtx;
+    // change to apply between ticks, on the thread that owns the bodies
+    struct Command {
+        std::function<int()> run;
+        std::promise<int> done;
+    };
 
-    double _tickSpeed;
-    double _timeScaling;
-    double _gravityScaling;
-    double _cScaling; // scaling speed of causality
+    BodyStore _bodies;
 
-    bool _paused;
+    mutable MpscQueue<Command> _commands;
+    std::atomic<bool> _queueCommands;
+    // last thread that drained the queue, its own commands run right away
+    std::atomic<std::thread::id> _commandThread;
+    // set by commands, handled once per batch
+    bool _bodiesChanged;
+    // lets an idle physics thread sleep until there is work
+    std::function<void()> _wakeHandler;
+
+    // splits the force evaluation of a tick
+    ThreadPool _pool;
+
+    DirectSolver _directSolver;
+    SymmetricSolver _symmetricSolver;
+    BarnesHutSolver _barnesHutSolver;
+    FmmSolver _fmmSolver;
+
+    // swapped by commands, read from any thread for their names
+    std::atomic<Solver*> _solver;
+
+    EulerIntegrator _eulerIntegrator;
+    LeapfrogIntegrator _leapfrogIntegrator;
+    YoshidaIntegrator _yoshidaIntegrator;
+    ForestRuthIntegrator _forestRuthIntegrator;
+    BlockIntegrator _blockIntegrator;
+    std::atomic<Integrator*> _integrator;
+
+    CollisionSystem _collisions;
+    ConservationMonitor _conservation;
+    Recorder _recorder;
+    // set while a recorded trajectory is played back instead of simulated
+    std::shared_ptr<Replay> _replay;
+
+    // written by commands (or directly for timeScaling), readable from any thread
+    std::atomic<double> _tickSpeed;
+    std::atomic<double> _timeScaling;
+    std::atomic<double> _gravityScaling;
+    std::atomic<double> _cScaling; // scaling speed of causality
+
+    std::atomic<bool> _paused;
+
+    std::atomic<unsigned long long> _tick;
+    // s
+    double _simulatedTime;
+
+    // completed ticks for the render thread and other readers
+    mutable TripleBuffer<Snapshot> _snapshots;
+    // bodies changed outside of a tick since the last publish
+    bool _snapshotStale;
+
+    // bodies or force parameters changed outside of a tick, drops cached accelerations
+    void InvalidateAccelerations();
+    // fills and publishes a snapshot if anything changed
+    void Publish();
+    // CalculateTick while replaying: moves the playback on by one tick of simulated time, pauses at the end
+    int ReplayTick();
+
+    // queues run for the next tick boundary, or runs it right away without a command queue
+    std::future<int> Submit(const std::function<int()>& run) const;
+    // waits for a submitted command, returns QUEUED with a message after commandTimeout
+    int Wait(std::future<int>& done) const;
+    int Wait(std::future<int>& done, double timeout) const;
+    int Execute(const std::function<int()>& run);
+    // like Wait, but the message tells the caller there is no answer
+    int WaitForAnswer(std::future<int>& done) const;
+
+    // evaluates query between ticks, returns its value or fallback after commandTimeout
+    template <class T>
+    T Query(const std::function<T()>& query, const T& fallback) const {
+        // shared, so a late answer after a timeout has somewhere to go
+        std::shared_ptr<T> result = std::make_shared<T>();
+        std::future<int> done = Submit([result, query]() {
+            *result = query();
+            return SUCCESS;
+        });
+        if (WaitForAnswer(done) != SUCCESS) {
+            // the physics thread may still be writing result
+            return fallback;
+        }
+        return *result;
+    }
 public:
     Time time;
 
@@ -27,29 +123,106 @@ public:
     
 
     // getters
+    // the ones answered by the physics thread return FAIL (or a negative value) when it does not answer in time
 
-    const std::map<std::string, Body>& GetBodies() const;
-    std::map<std::string, Body>& GetBodiesMut(); // bodies are mutable
+    // not synchronized, only for the thread calling CalculateTick
+    const BodyStore& GetBodies() const;
+    // copies the whole store between ticks (reuses the capacity of bodies)
+    int CopyBodies(BodyStore& bodies) const;
+    int GetBody(const std::string& name, Body& body) const;
     double GetTickSpeed() const;
     double GetTimeScaling() const;
     double GetGravityScaling() const;
     double GetcScaling() const;
+    int GetThreadCount() const;
+    const char* GetSolver() const;
+    double GetOpeningAngle() const;
+    int GetFmmOrder() const;
+    double GetFmmOpeningAngle() const;
+    const char* GetIntegrator() const;
+    int GetBlockLevels() const;
+    // body force evaluations of the last block tick
+    long long GetBlockEvaluations() const;
+    // empty when the physics thread does not answer
+    std::string GetCollisions() const;
+    // touching pairs found in the last tick
+    long long GetLastContacts() const;
+    // totals and drifts since the last change to the bodies or the physical constants
+    int GetConservation(ConservationStats& stats) const;
+    int GetEnergyInterval() const;
+    int GetRecording(RecorderStats& stats) const;
+    int GetReplay(ReplayStats& stats) const;
+    // evaluates the active solver once more at the current positions and compares it with an exact sum
+    int EstimateSolverError(SolverError& error);
     bool IsPaused() const;
+    unsigned long long GetTick() const;
+
+    // snapshot readers, each id belongs to one thread
+    // returns -1 when all reader slots are taken
+    int RegisterSnapshotReader() const;
+    // newest published tick, nullptr before the first one
+    // valid until the next Acquire / Release with the same reader, never blocks the physics thread
+    const Snapshot* AcquireSnapshot(int reader) const;
+    void ReleaseSnapshot(int reader) const;
 
 
     // setters / manipulators
+    // once the command queue is used they run on the physics thread between ticks,
+    // the caller waits for the result up to commandTimeout, after that they return QUEUED and still apply later
+
+    // from now on changes are queued for the thread calling CalculateTick / ProcessCommands
+    // call before that thread starts, without it changes apply immediately (single threaded use)
+    void UseCommandQueue();
+    // called after a change is queued or the universe is unpaused, set before the threads start
+    void SetWakeHandler(const std::function<void()>& wake);
 
     int AddBody(const std::string& name, const Body& body);
     int RemoveBody(const std::string& name);
     int ClearBodies();
+    // applies update to a copy of the body between ticks, name changes are ignored
+    int UpdateBody(const std::string& name, const std::function<void(Body&)>& update);
+    // writes every body and the scalar settings between ticks, physics waits for the write
+    int SaveCheckpoint(const std::string& path) const;
+    // reads the file on the calling thread, then swaps it in between ticks
+    int LoadCheckpoint(const std::string& path);
     int SetTickSpeed(double tickSpeed);
     int SetTimeScaling(double timeScaling);
     int SetGravityScaling(double gravityScaling);
     int SetcScaling(double cScaling);
+    int SetThreadCount(int threadCount);
+    // "direct", "symmetric", "barneshut" or "fmm"
+    int SetSolver(const std::string& name);
+    int SetOpeningAngle(double theta);
+    int SetFmmOrder(int order);
+    int SetFmmOpeningAngle(double theta);
+    // "euler", "leapfrog", "yoshida4", "forestruth" or "block"
+    int SetIntegrator(const std::string& name);
+    int SetBlockLevels(int levels);
+    // "off", "log", "bounce" or "merge"
+    int SetCollisions(const std::string& response);
+    // ticks between potential energy evaluations, 0 turns them off
+    int SetEnergyInterval(int ticks);
+    // captures every options.decimation-th tick from now on, a writer thread compresses them to options.path
+    int StartRecording(const RecorderOptions& options);
+    // waits for the writer to drain and closes the file
+    int StopRecording();
+    // maps a trajectory file on the calling thread, then shows its first frame in place of the bodies
+    // from then on ticks advance the playback by timeScaling / tickSpeed instead of simulating,
+    // pause / unpause and SetTimeScaling control it
+    int OpenReplay(const std::string& path);
+    // shows the last frame at or before time (s)
+    int SeekReplay(double time);
+    // the bodies of the shown frame stay, without masses
+    int CloseReplay();
     int Pause();
     int Unpause();
 
+    // applies queued changes, advances one tick and publishes a snapshot
     int CalculateTick();
+    // applies every queued change in one batch, physics thread only
+    int ProcessCommands();
+    // physics thread only, publishes changes made while paused
+    int PublishSnapshot();
 };
 
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "window.hpp"
 
 #include <cmath>
+#include <cstddef>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -15,9 +16,11 @@
 
 #include "body.hpp"
 #include "definitions.hpp"
+#include "geometry.hpp"
+#include "profiler.hpp"
 
-// POS.X, POS.Y, POS.Z, COLOR.R, COLOR.G, COLOR.B, TEX.X, TEX.Y, LUMINOSITY, NORMAL.X, NORMAL.Y, NORMAL.Z
-constexpr int vertexFloatWidth = 12;
+// diameter of the heaviest or most luminous bodies in points mode, px
+constexpr float cloudMaxPointSize = 6.0f;
 
 inline glm::vec3 AngleToVector(const float& theta, const float& phi, const float& psi) {
     float r_theta = glm::radians(theta);
@@ -28,6 +31,122 @@ inline glm::vec3 AngleToVector(const float& theta, const float& phi, const float
     return glm::vec3(x, y, z);
 }
 
+// reads a whole shader source file
+inline int ReadShaderFile(const std::string& path, std::string& source) {
+    std::ifstream file(path, std::ios_base::binary);
+    if (!file.is_open()) {
+        std::cout << "cannot open " << path << "\n";
+        return FAIL;
+    }
+    source.clear();
+    while (!file.eof()) {
+        source.push_back(file.get());
+    }
+    source.pop_back();
+    file.close();
+    return SUCCESS;
+}
+
+inline int CompileShader(GLenum type, const std::string& path, unsigned int& shader) {
+    std::string source;
+    if (ReadShaderFile(path, source) <= FAIL) {
+        return FAIL;
+    }
+    // create shader object
+    shader = glCreateShader(type);
+    // attach source to shader object and compile
+    const char* sourceData = source.c_str();
+    glShaderSource(shader, 1, &sourceData, NULL);
+    glCompileShader(shader);
+    // if compilation failed
+    int success;
+    char infoLog[512];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        std::cout << path << " compilation failed\n" << infoLog << std::endl;
+        glDeleteShader(shader);
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+// compiles both stages and links them into program
+inline int LinkShaderProgram(const std::string& vertexPath, const std::string& fragmentPath, unsigned int& program) {
+    unsigned int vertexShader, fragmentShader;
+    if (CompileShader(GL_VERTEX_SHADER, vertexPath, vertexShader) <= FAIL) {
+        return FAIL;
+    }
+    if (CompileShader(GL_FRAGMENT_SHADER, fragmentPath, fragmentShader) <= FAIL) {
+        glDeleteShader(vertexShader);
+        return FAIL;
+    }
+    // create shader program to merge two pieces
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    // delete old objects, the program keeps them
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    // check for failure (even more)
+    int success;
+    char infoLog[512];
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        std::cout << vertexPath << " + " << fragmentPath << " linking failed\n" << infoLog << std::endl;
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+// keeps camera at its distance behind the body it is locked to, false if it is not locked to one in bodies
+inline bool FollowBody(Camera& camera, const Snapshot& bodies, const glm::vec3& front) {
+    // skips searching millions of names while unlocked
+    if (camera.bodyName == "") {
+        return false;
+    }
+    size_t index = bodies.IndexOf(camera.bodyName);
+    if (index == Snapshot::npos) {
+        return false;
+    }
+    camera.x = bodies.x[index] - front.x * camera.bodyDistance;
+    camera.y = bodies.y[index] - front.y * camera.bodyDistance;
+    camera.z = bodies.z[index] - front.z * camera.bodyDistance;
+    return true;
+}
+
+inline ShaderUniforms FindUniforms(unsigned int program) {
+    ShaderUniforms uniforms;
+    uniforms.viewMatrix = glGetUniformLocation(program, "viewMatrix");
+    uniforms.projectionMatrix = glGetUniformLocation(program, "projectionMatrix");
+    uniforms.lightPos = glGetUniformLocation(program, "lightPos");
+    uniforms.cameraPos = glGetUniformLocation(program, "cameraPos");
+    uniforms.pixelScale = glGetUniformLocation(program, "pixelScale");
+    uniforms.maxPointSize = glGetUniformLocation(program, "maxPointSize");
+    return uniforms;
+}
+
+// points the instance attributes (position, radius, color, luminosity, theta at consecutive locations from
+// firstLocation) of the bound vertex array at the bound array buffer, starting with instance firstInstance
+// of the data written at byte offset
+inline void BindInstanceAttributes(int firstLocation, size_t offset, size_t firstInstance) {
+    // components, offset in floats
+    const int instanceAttributes[][2] = {
+        { 3, 0 }, // position
+        { 1, 3 }, // radius
+        { 3, 4 }, // color
+        { 1, 7 }, // luminosity
+        { 1, 8 }  // theta
+    };
+    size_t base = firstInstance * instanceFloatWidth;
+    for (int i = 0; i < 5; i++) {
+        glVertexAttribPointer(firstLocation + i, instanceAttributes[i][0], GL_FLOAT, GL_FALSE, instanceFloatWidth * sizeof(float),
+            (void*)(offset + (base + instanceAttributes[i][1]) * sizeof(float)));
+    }
+}
+
 
 // window functions
 
@@ -35,6 +154,16 @@ Window::Window() {
     _horRes = 1600;
     _vertRes = 900;
     _fov = 75;
+    _snapshotReader = -1;
+    _visibleBodies = 0;
+    _culledBodies = 0;
+    for (std::atomic<size_t>& count: _levelBodies) {
+        count = 0;
+    }
+    _uploadReallocations = 0;
+    _uploadStalls = 0;
+    _uploadOrphaning = false;
+    _renderMode = RenderMode::spheres;
 }
 
 int Window::OpenWindow() {
@@ -71,116 +200,114 @@ int Window::SetupOpenGL() {
     }
     gladLoadGLLoader(SDL_GL_GetProcAddress);
 
-    // gather shaders
-    std::ifstream vertexShaderFile("src/shaders/vertexshader.glsl", std::ios_base::binary);
-    if (!vertexShaderFile.is_open()) return FAIL;
-    std::ifstream fragmentShaderFile("src/shaders/fragmentshader.glsl", std::ios_base::binary);
-    if (!fragmentShaderFile.is_open()) return FAIL;
-
-    std::string vertexShaderSource, fragmentShaderSource;
-    while (!vertexShaderFile.eof()) {
-        vertexShaderSource.push_back(vertexShaderFile.get());
-    }
-    vertexShaderSource.pop_back();
-    vertexShaderFile.close();
-    while (!fragmentShaderFile.eof()) {
-        fragmentShaderSource.push_back(fragmentShaderFile.get());
-    }
-    fragmentShaderSource.pop_back();
-    fragmentShaderFile.close();
-
     // Use v-sync
     // SDL_GL_SetSwapInterval(1);
 
     glEnable(GL_DEPTH_TEST);
+    // impostors size themselves in the vertex shader
+    glEnable(GL_PROGRAM_POINT_SIZE);
 
     // tell opengl window size
     glViewport(0, 0, _horRes, _vertRes);
 
-    // create shader object
-    unsigned int vertexShader;
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    // attach source to shader object and compile
-    const char* vSS = vertexShaderSource.c_str();
-    glShaderSource(vertexShader, 1, &vSS, NULL);
-    glCompileShader(vertexShader);
-    // if compilation failed
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, sizeof(infoLog), NULL, infoLog);
-        std::cout << "vertex compilation failed\n" << infoLog << std::endl;
+    if (LinkShaderProgram("src/shaders/vertexshader.glsl", "src/shaders/fragmentshader.glsl", _shaderProgram) <= FAIL) {
         return FAIL;
     }
-
-    // setup and compile fragment shader
-    unsigned int fragmentShader;
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    const char* fSS = fragmentShaderSource.c_str();
-    glShaderSource(fragmentShader, 1, &fSS, NULL);
-    glCompileShader(fragmentShader);
-    // if compilation failed (again)
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, sizeof(infoLog), NULL, infoLog);
-        std::cout << "fragment compilation failed\n" << infoLog << std::endl;
+    if (LinkShaderProgram("src/shaders/pointvertexshader.glsl", "src/shaders/pointfragmentshader.glsl", _pointProgram) <= FAIL) {
         return FAIL;
     }
-
-    // create shader program to merge two pieces
-    _shaderProgram = glCreateProgram();
-    // creates and links
-    glAttachShader(_shaderProgram, vertexShader);
-    glAttachShader(_shaderProgram, fragmentShader);
-    glLinkProgram(_shaderProgram);
-    // check for failure (even more)
-    glGetProgramiv(_shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(_shaderProgram, 512, NULL, infoLog);
-        std::cout << "shaderProgram compilation failed\n" << infoLog << std::endl;
+    if (LinkShaderProgram("src/shaders/cloudvertexshader.glsl", "src/shaders/cloudfragmentshader.glsl", _cloudProgram) <= FAIL) {
         return FAIL;
     }
-
-    // use this program
-    glUseProgram(_shaderProgram);
-    // delete old objects
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    _shaderUniforms = FindUniforms(_shaderProgram);
+    _pointUniforms = FindUniforms(_pointProgram);
+    _cloudUniforms = FindUniforms(_cloudProgram);
 
     // setup other stuffs
 
     glGenVertexArrays(1, &_VAO);
+    glGenVertexArrays(1, &_pointVAO);
+    glGenVertexArrays(1, &_cloudVAO);
     glGenBuffers(1, &_VBO);
     glGenBuffers(1, &_EBO);
+    if (_instanceStream.Create() <= FAIL) {
+        return FAIL;
+    }
 
     glBindVertexArray(_VAO);
+
+    // every body is one of a few unit spheres, moved and scaled in the vertex shader
+    std::vector<float> meshVertices;
+    std::vector<unsigned int> meshElements;
+    BuildSphereLods(meshVertices, meshElements, _sphereLods);
     glBindBuffer(GL_ARRAY_BUFFER, _VBO);
+    glBufferData(GL_ARRAY_BUFFER, meshVertices.size() * sizeof(float), meshVertices.data(), GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshElements.size() * sizeof(unsigned int), meshElements.data(), GL_STATIC_DRAW);
 
     // set vertex attributes pointers
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexFloatWidth * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, meshFloatWidth * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    // color
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, vertexFloatWidth * sizeof(float), (void*)(3 * sizeof(float)));
+    // invert (poles)
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, meshFloatWidth * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    // texture
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, vertexFloatWidth * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    // instance attributes, advance once per body
+    // pointed at the region written each frame before drawing
+    glBindBuffer(GL_ARRAY_BUFFER, _instanceStream.GetBuffer());
+    for (int location = 2; location <= 6; location++) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    BindInstanceAttributes(2, 0, 0);
+
+    // impostors read the same instances, one point each
+    glBindVertexArray(_pointVAO);
+    for (int location = 0; location <= 3; location++) {
+        glEnableVertexAttribArray(location);
+    }
+    BindInstanceAttributes(0, 0, 0);
+
+    // point cloud mode, position and packed color of every body, pointed at the written region before drawing
+    glBindVertexArray(_cloudVAO);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(_VAO);
 
-    // minBrightness
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, vertexFloatWidth * sizeof(float), (void*)(8 * sizeof(float)));
-    glEnableVertexAttribArray(3);
+    return SUCCESS;
+}
 
-    // normals
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, vertexFloatWidth * sizeof(float), (void*)(9 * sizeof(float)));
-    glEnableVertexAttribArray(4);
+const char* Window::GetRenderMode() const {
+    return _renderMode.load(std::memory_order_relaxed) == RenderMode::points ? "points" : "spheres";
+}
 
+int Window::SetRenderMode(const std::string& name) {
+    if (name == "spheres") {
+        _renderMode = RenderMode::spheres;
+    }
+    else if (name == "points") {
+        _renderMode = RenderMode::points;
+    }
+    else {
+        return FAIL;
+    }
     return SUCCESS;
 }
 
+RenderStats Window::GetRenderStats() const {
+    RenderStats stats;
+    stats.visible = _visibleBodies.load(std::memory_order_relaxed);
+    stats.culled = _culledBodies.load(std::memory_order_relaxed);
+    for (int level = 0; level <= sphereLodCount; level++) {
+        stats.levels[level] = _levelBodies[level].load(std::memory_order_relaxed);
+    }
+    stats.upload.reallocations = _uploadReallocations.load(std::memory_order_relaxed);
+    stats.upload.stalls = _uploadStalls.load(std::memory_order_relaxed);
+    stats.upload.orphaning = _uploadOrphaning.load(std::memory_order_relaxed);
+    return stats;
+}
+
 const Camera& Window::GetCamera() const {
     return _camera;
 }
@@ -351,167 +478,167 @@ int Window::ChangeCameraBodyDistance(double forward) {
     return SUCCESS;
 }
 
-inline void AddValues(std::vector<float>& vertexData, float f0, float f1, float f2) {
-    vertexData.push_back(f0);
-    vertexData.push_back(f1);
-    vertexData.push_back(f2);
-}
-
-inline void AddValues(std::vector<unsigned int>& elementData, unsigned int f0, unsigned int f1, unsigned int f2) {
-    elementData.push_back(f0);
-    elementData.push_back(f1);
-    elementData.push_back(f2);
-}
-
-inline void DrawSphere(const Body& body, const Camera& camera, std::vector<float>& vertexData, std::vector<unsigned int>& elementData) {
-    // tracks initial vertexData size to offset indices
-    int elementStart = vertexData.size() / vertexFloatWidth;
-    int elementIndexStart = elementData.size();
-
-    const int stackCount = 45;
-    const int sectorCount = 45;
-    const float stackAngle = 180.0 / stackCount;
-    const float sectorAngle = 360.0 / sectorCount;
-
-    const double x = body.x, y = body.y, z = body.z;
-    // delta
-    double dx = 0, dy = 0, dz = 0;
-    // delta normalized
-    double dxn = 0, dyn = 0, dzn = 0;
-    const double radius = body.radius;
-
-    // vertexData
-    // top
-    AddValues(vertexData, x, y, z + radius); // position
-    AddValues(vertexData, 1.0 - body.red, 1.0f - body.green, 1.0f - body.blue); // color (inverted)
-    vertexData.push_back(0.0f); // tex.x
-    vertexData.push_back(0.0f); // tex.y
-    vertexData.push_back((float)body.luminosity); // minBrightness
-    AddValues(vertexData, 0.0f, 0.0f, 1.0f); // normal
-    // all other points
-    for (int i = 1; i < stackCount; i++) {
-        dzn = cos(glm::radians(i * stackAngle));
-        dz = radius * dzn;
-        for (int j = 0; j < sectorCount; j++) {
-            dxn = sin(glm::radians(i * stackAngle)) * cos(glm::radians(j * sectorAngle + body.theta));
-            dyn = sin(glm::radians(i * stackAngle)) * sin(glm::radians(j * sectorAngle + body.theta));
-            dx = radius * dxn;
-            dy = radius * dyn;
-            AddValues(vertexData, x + dx, y + dy, z + dz); // position
-            AddValues(vertexData, body.red, body.green, body.blue); // color
-            vertexData.push_back(0.0f); // tex.x
-            vertexData.push_back(0.0f); // tex.y
-            vertexData.push_back((float)body.luminosity); // minBrightness
-            AddValues(vertexData, dxn, dyn, dzn); // normals
-        }
-    }
-    // bottom
-    AddValues(vertexData, x, y, z - radius); // position
-    AddValues(vertexData, 1.0 - body.red, 1.0f - body.green, 1.0f - body.blue); // color (inverted)
-    vertexData.push_back(0.0f); // tex.x
-    vertexData.push_back(0.0f); // tex.y
-    vertexData.push_back((float)body.luminosity); // minBrightness
-    AddValues(vertexData, 0.0f, 0.0f, -1.0f); // normal
-
-    // elementData
-    // top triangles
-    for (int j = 1; j <= sectorCount; j++) {
-        AddValues(elementData, 0, j, (j % sectorCount) + 1);
-    }
-    // middle squares
-    for (int i = 0; i < (stackCount - 1); i++) {
-        if (i > 0) {
-            int rowIndexStart = sectorCount * i;
-            for (int j = 1; j <= sectorCount; j++) {
-                int vertex1 = j + rowIndexStart;
-                int vertex2 = (j % sectorCount) + 1 + rowIndexStart;
-                int vertex3 = (j % sectorCount) + 1 + rowIndexStart - sectorCount;
-                AddValues(elementData, vertex1, vertex2, vertex3);
-            }
-        }
-        if (i < (stackCount - 2)) {
-            int rowIndexStart = sectorCount * i;
-            for (int j = 1; j <= sectorCount; j++) {
-                int vertex1 = j + rowIndexStart;
-                int vertex2 = (j % sectorCount) + 1 + rowIndexStart;
-                int vertex3 = j + sectorCount + rowIndexStart;
-                AddValues(elementData, vertex1, vertex2, vertex3);
-            }
-        }
-    }
-    // bottom triangles
-    int start = (stackCount - 2) * sectorCount + 1;
-    int end = (stackCount - 1) * sectorCount;
-    for (int j = start; j <= end; j++) {
-        AddValues(elementData, end + 1, j, start + (j % sectorCount));
-    }
-    // offset indices by element start value
-    // this could maybe be factored into all the above calculations, but this has benefits too
-    for (int i = elementIndexStart; i < elementData.size(); i++) {
-        elementData[i] += elementStart;
-    }
-}
-
 int Window::DrawFrame(const Universe& universe) {
+    ScopedTimer frameTimer(Phase::frame);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-    const auto bodies = universe.GetBodies();
-    std::vector<float> vertexData;
-    std::vector<unsigned int> elementData;
+    if (_snapshotReader < 0) {
+        _snapshotReader = universe.RegisterSnapshotReader();
+    }
+    // the newest completed tick, physics keeps running while it is drawn
+    const Snapshot* snapshot = _snapshotReader >= 0 ? universe.AcquireSnapshot(_snapshotReader) : nullptr;
+    if (snapshot == nullptr) {
+        SDL_GL_SwapWindow(_window);
+        return SUCCESS;
+    }
+    const Snapshot& bodies = *snapshot;
+    if (_renderMode.load(std::memory_order_relaxed) == RenderMode::points) {
+        return DrawPointCloud(universe, bodies);
+    }
 
     glm::vec3 camPosition(_camera.x, _camera.y, _camera.z);
     glm::vec3 camFront(AngleToVector(_camera.theta, _camera.phi, _camera.psi));
     glm::vec3 lightPosition(0.0f, 0.0f, 0.0f);
-    _mtx.lock();
-    for (const auto& [id, body]: bodies) {
-        DrawSphere(body, _camera, vertexData, elementData);
-        if (body.luminosity == 1.0f) {
-            lightPosition.x = (float)body.x;
-            lightPosition.y = (float)body.y;
-            lightPosition.z = (float)body.z;
+    // px per unit of radius / distance
+    float pixelScale = (_vertRes / 2.0f) / tan(glm::radians(_fov) / 2.0f);
+    {
+        ScopedTimer timer(Phase::spheres);
+        _mtx.lock();
+        for (size_t i = 0; i < bodies.Size(); i++) {
+            if (bodies.luminosity[i] == 1.0f) {
+                lightPosition.x = (float)bodies.x[i];
+                lightPosition.y = (float)bodies.y[i];
+                lightPosition.z = (float)bodies.z[i];
+            }
         }
         // if camera is locked to body
-        if (id == _camera.bodyName) {
-            double cdx = -camFront.x * _camera.bodyDistance;
-            double cdy = -camFront.y * _camera.bodyDistance;
-            double cdz = -camFront.z * _camera.bodyDistance;
-            double newX = body.x + cdx;
-            double newY = body.y + cdy;
-            double newZ = body.z + cdz;
-            
-            _camera.x = newX;
-            _camera.y = newY;
-            _camera.z = newZ;
-            camPosition.x = newX;
-            camPosition.y = newY;
-            camPosition.z = newZ;
+        if (FollowBody(_camera, bodies, camFront)) {
+            camPosition = glm::vec3(_camera.x, _camera.y, _camera.z);
         }
+        // the level of each body depends on where the camera ended up
+        LodView view;
+        view.x = _camera.x;
+        view.y = _camera.y;
+        view.z = _camera.z;
+        view.pixelScale = pixelScale;
+        const double front[3] = { camFront.x, camFront.y, camFront.z };
+        const double up[3] = { 0.0, 0.0, 1.0 };
+        SetViewFrustum(view, front, up, _fov, (double)_horRes / _vertRes);
+        FillSphereInstances(bodies, view, _instances);
+        _mtx.unlock();
     }
-    _mtx.unlock();
+    _visibleBodies.store(_instances.visible, std::memory_order_relaxed);
+    _culledBodies.store(_instances.culled, std::memory_order_relaxed);
+    for (int level = 0; level <= sphereLodCount; level++) {
+        _levelBodies[level].store(_instances.counts[level], std::memory_order_relaxed);
+    }
+    universe.ReleaseSnapshot(_snapshotReader);
 
     float nearPlane = 0.1f;
     float farPlane = 1000.0f;
 
     glm::mat4 viewMatrix(1.0f);
     viewMatrix = glm::lookAt(camPosition, camPosition + camFront, glm::vec3(0.0f, 0.0f, 1.0f));
-    auto viewMatrixLocation = glGetUniformLocation(_shaderProgram, "viewMatrix");
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(viewMatrix));
 
     glm::mat4 projectionMatrix(1.0f);
     projectionMatrix = glm::perspective(glm::radians(_fov), (float)_horRes / (float)_vertRes, nearPlane, farPlane);
-    auto projectionMatrixLocation = glGetUniformLocation(_shaderProgram, "projectionMatrix");
-    glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
 
-    auto lightPosLocation = glGetUniformLocation(_shaderProgram, "lightPos");
-    glUniform3fv(lightPosLocation, 1, glm::value_ptr(lightPosition));
+    size_t instanceOffset;
+    {
+        ScopedTimer timer(Phase::upload);
+        // only the instances change, the meshes stay on the gpu
+        instanceOffset = _instanceStream.Write(_instances.data.data(), _instances.data.size() * sizeof(float));
+    }
+
+    // includes waiting for the swap
+    ScopedTimer drawTimer(Phase::draw);
+    glUseProgram(_shaderProgram);
+    glBindVertexArray(_VAO);
+    glUniformMatrix4fv(_shaderUniforms.viewMatrix, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+    glUniformMatrix4fv(_shaderUniforms.projectionMatrix, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+    glUniform3fv(_shaderUniforms.lightPos, 1, glm::value_ptr(lightPosition));
+    // one instanced draw per level, its instances are contiguous
+    for (int level = 0; level < sphereLodCount; level++) {
+        if (_instances.counts[level] == 0) {
+            continue;
+        }
+        const SphereLod& lod = _sphereLods[level];
+        BindInstanceAttributes(2, instanceOffset, _instances.first[level]);
+        glDrawElementsInstanced(GL_TRIANGLES, lod.elementCount, GL_UNSIGNED_INT,
+            (void*)(lod.firstElement * sizeof(unsigned int)), _instances.counts[level]);
+    }
+
+    // bodies smaller than a pixel or two
+    if (_instances.counts[impostorLevel] > 0) {
+        glUseProgram(_pointProgram);
+        glBindVertexArray(_pointVAO);
+        BindInstanceAttributes(0, instanceOffset, 0);
+        glUniformMatrix4fv(_pointUniforms.viewMatrix, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+        glUniformMatrix4fv(_pointUniforms.projectionMatrix, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+        glUniform3fv(_pointUniforms.lightPos, 1, glm::value_ptr(lightPosition));
+        glUniform3fv(_pointUniforms.cameraPos, 1, glm::value_ptr(camPosition));
+        glUniform1f(_pointUniforms.pixelScale, pixelScale);
+        glUniform1f(_pointUniforms.maxPointSize, 2.0f * sphereLodPixels[sphereLodCount - 1]);
+        glDrawArrays(GL_POINTS, _instances.first[impostorLevel], _instances.counts[impostorLevel]);
+    }
+    // the region is reused once the gpu has passed this point
+    _instanceStream.Fence();
+    StreamStats upload = _instanceStream.GetStats();
+    _uploadReallocations.store(upload.reallocations, std::memory_order_relaxed);
+    _uploadStalls.store(upload.stalls, std::memory_order_relaxed);
+    _uploadOrphaning.store(upload.orphaning, std::memory_order_relaxed);
+
+    SDL_GL_SwapWindow(_window);
+    return SUCCESS;
+}
 
-    // copy vertex data into buffer
-    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STREAM_DRAW);
-    // copy element data buffer
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementData.size() * sizeof(unsigned int), elementData.data(), GL_STREAM_DRAW);
+int Window::DrawPointCloud(const Universe& universe, const Snapshot& bodies) {
+    glm::vec3 camFront(AngleToVector(_camera.theta, _camera.phi, _camera.psi));
+    _mtx.lock();
+    FollowBody(_camera, bodies, camFront);
+    glm::vec3 camPosition(_camera.x, _camera.y, _camera.z);
+    _mtx.unlock();
+    size_t count = bodies.Size();
+    _visibleBodies.store(count, std::memory_order_relaxed);
+    _culledBodies.store(0, std::memory_order_relaxed);
+    for (std::atomic<size_t>& levelCount: _levelBodies) {
+        levelCount.store(0, std::memory_order_relaxed);
+    }
 
-    glDrawElements(GL_TRIANGLES, elementData.size() * sizeof(unsigned int), GL_UNSIGNED_INT, 0);
+    size_t pointOffset;
+    {
+        ScopedTimer timer(Phase::upload);
+        // no instances or culling, every body goes straight from the snapshot into the mapped buffer
+        CloudPoint* points = (CloudPoint*)_instanceStream.Map(count * sizeof(CloudPoint), pointOffset);
+        if (count > 0) {
+            FillPointCloud(bodies, _cloudScale, points);
+        }
+        _instanceStream.Unmap();
+    }
+    universe.ReleaseSnapshot(_snapshotReader);
+
+    glm::mat4 viewMatrix = glm::lookAt(camPosition, camPosition + camFront, glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 projectionMatrix = glm::perspective(glm::radians(_fov), (float)_horRes / (float)_vertRes, 0.1f, 1000.0f);
+
+    ScopedTimer drawTimer(Phase::draw);
+    if (count > 0) {
+        glUseProgram(_cloudProgram);
+        glBindVertexArray(_cloudVAO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CloudPoint), (void*)pointOffset);
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CloudPoint), (void*)(pointOffset + offsetof(CloudPoint, color)));
+        glUniformMatrix4fv(_cloudUniforms.viewMatrix, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+        glUniformMatrix4fv(_cloudUniforms.projectionMatrix, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+        glUniform1f(_cloudUniforms.maxPointSize, cloudMaxPointSize);
+        // overlapping points add up, so dense regions glow and nothing needs sorting
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glDrawArrays(GL_POINTS, 0, count);
+        glDisable(GL_BLEND);
+        glEnable(GL_DEPTH_TEST);
+    }
+    _instanceStream.Fence();
 
     SDL_GL_SwapWindow(_window);
     return SUCCESS;
@@ -2,6 +2,7 @@
 #ifndef _WINDOW_HPP
 #define _WINDOW_HPP
 
+#include <atomic>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -9,9 +10,42 @@
 #include <SDL.h>
 
 #include "camera.hpp"
+#include "geometry.hpp"
+#include "snapshot.hpp"
+#include "streambuffer.hpp"
 #include "time.hpp"
 #include "universe.hpp"
 
+// bodies of the last frame
+struct RenderStats {
+    size_t visible = 0;
+    // outside the view frustum, never built or drawn
+    size_t culled = 0;
+    // visible bodies per sphere level, impostors last
+    size_t levels[sphereLodCount + 1] = {};
+    // instance uploads since the window opened
+    StreamStats upload;
+};
+
+// how bodies are drawn
+enum class RenderMode {
+    // lit spheres with levels of detail and culling
+    spheres,
+    // one additive point per body, sized and brightened by mass or luminosity, for millions of bodies
+    points
+};
+
+// uniform locations of a shader program, looked up once after linking
+// -1 for uniforms the program does not have, setting those is a no-op
+struct ShaderUniforms {
+    int viewMatrix = -1;
+    int projectionMatrix = -1;
+    int lightPos = -1;
+    int cameraPos = -1;
+    int pixelScale = -1;
+    int maxPointSize = -1;
+};
+
 class Window {
     SDL_Window* _window;
     SDL_GLContext _context;
@@ -21,19 +55,55 @@ class Window {
 
     Camera _camera;
 
+    // reader id for the universe's snapshots, registered on the first frame
+    int _snapshotReader;
+
     int _horRes;
     int _vertRes;
     float _fov;
 
     // openGL "objects"
 
+    // lit spheres
     unsigned int _shaderProgram;
-    // array object
+    // point impostors of bodies below a pixel or two
+    unsigned int _pointProgram;
+    // array object, spheres
     unsigned int _VAO;
-    // vertices
+    // point cloud mode
+    unsigned int _cloudProgram;
+    // array object, impostors
+    unsigned int _pointVAO;
+    // array object, point cloud
+    unsigned int _cloudVAO;
+    // unit sphere vertices of every level, uploaded once
     unsigned int _VBO;
-    // elements
+    // unit sphere elements of every level, uploaded once
     unsigned int _EBO;
+    // per body instance data, streamed every frame
+    StreamBuffer _instanceStream;
+    ShaderUniforms _shaderUniforms;
+    ShaderUniforms _pointUniforms;
+    ShaderUniforms _cloudUniforms;
+    // mass range of the last point cloud frame
+    CloudScale _cloudScale;
+
+    // set by the console, read by the render thread
+    std::atomic<RenderMode> _renderMode;
+    std::vector<SphereLod> _sphereLods;
+    // kept between frames so its capacity is reused
+    SphereInstances _instances;
+
+    // written by the render thread, read by the console
+    std::atomic<size_t> _visibleBodies;
+    std::atomic<size_t> _culledBodies;
+    std::atomic<size_t> _levelBodies[sphereLodCount + 1];
+    std::atomic<size_t> _uploadReallocations;
+    std::atomic<size_t> _uploadStalls;
+    std::atomic<bool> _uploadOrphaning;
+
+    // DrawFrame in points mode, releases the snapshot
+    int DrawPointCloud(const Universe& universe, const Snapshot& bodies);
 public:
     Time time;
 
@@ -46,6 +116,9 @@ public:
     int SetupOpenGL();
 
     // getters
+    // "spheres" or "points"
+    const char* GetRenderMode() const;
+    RenderStats GetRenderStats() const;
     const Camera& GetCamera() const;
     bool CameraLocked() const;
     double GetCameraSpeed() const;
@@ -54,6 +127,9 @@ public:
 
     // setters
 
+    // fails if the mode is unknown
+    int SetRenderMode(const std::string& name);
+
     int SetCameraSpeed(double speed);
     int SetCameraRotationSpeed(double rotationSpeed);
     int SetCameraSensitivity(double sensitivity);